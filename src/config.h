@@ -5,9 +5,31 @@
 
 #define USE_MODBUS // Uncomment to enable Modbus support
 #define USE_HTTP // Uncomment to enable HTTP server support
+// #define USE_MQTT // Uncomment to enable MQTT publishing (broker address in main.h)
+// #define USE_UDP // Uncomment to enable UDP change notifications
 // #define USE_SERIAL // Uncomment to enable debug serial
+// #define USE_PROFILER // Uncomment to time every task, GET /profile and Modbus input registers 1000+ (~20 B RAM per scheduler slot, ~500 B)
+// #define USE_METRICS // Uncomment to count protocol and device events, GET /metrics (~150 B RAM)
+// #define USE_HISTORY // Uncomment to keep sample history of chosen devices, GET /<name>/history and Modbus input registers 2000+ (~160 B RAM per device)
+// #define USE_EVENT_LOG // Uncomment to log input edges and relay changes for Modbus Read FIFO Queue (0x18) (~140 B RAM)
+// #define USE_RULES // Uncomment to run input to relay rules on the device, GET /rules, stored in EEPROM (~140 B RAM)
+// #define USE_IDLE_SLEEP // Uncomment to sleep in idle mode while no task is due (sockets are then polled every 1 ms, up to 1 ms more latency)
 
 #define MODBUS_SOCKETS 2    // Number of Modbus sockets to use
+#define HTTP_SOCKETS 2      // Number of HTTP sockets to use
+#define MODBUS_PIPELINE_DEPTH 2 // Max queued Modbus requests answered in one write (1 disables pipelining)
+#define UDP_PORT 5005       // Port of UDP change notifications
+
+// Static RAM, the ATmega328p has 2048 B. The network tasks, the scheduler and
+// the optional features are checked against RAM_BUDGET_BUFFERS when building
+// for AVR, see the end of main.h. Estimates at the settings above:
+//   Modbus  ~320 B, ~110 B per socket plus the map and process image, and a
+//           shared send buffer of 64 B per MODBUS_PIPELINE_DEPTH
+//   HTTP    ~260 B, ~125 B per socket
+//   scheduler ~150 B, 6 B per task slot (the profiler adds ~500 B here)
+// The rest is left to the devices, 1-Wire buses and Modbus table (~1 KB at
+// the defaults), the libraries and the stack. Check avr-size after changes.
+#define RAM_BUDGET_BUFFERS 1000
 
 
 #endif // CONFIG_H
\ No newline at end of file
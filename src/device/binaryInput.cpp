@@ -1,13 +1,41 @@
 #include "binaryInput.h"
+#include "eventLog.h"
 
-BinaryInput::BinaryInput(String _name, int _pin) {
+BinaryInput::BinaryInput(String _name, int _pin, InputMode _mode) {
     strncpy(name, _name.c_str(), MAX_NAME_SIZE - 1);
     pin = _pin;
     pinMode(pin, INPUT_PULLUP);
     state = InputState::OFF;
+
+    if (_mode == InputMode::INTERRUPT) {
+        rawLevel = digitalRead(pin);
+        rawTs = micros();
+        // fall back to polling on pins without a pin change interrupt
+        if (PinChange::attach(pin, &edgeBuffer)) {
+            mode = InputMode::INTERRUPT;
+            debounceInterval = INPUT_PULSE_DEBOUNCE;
+        }
+    } else {
+        mode = _mode;
+    }
 }
 
 bool BinaryInput::spin() {
+    bool busy = false;
+    if (mode == InputMode::INTERRUPT) {
+        busy = spinInterrupt();
+    } else if (mode == InputMode::POLLED) {
+        busy = spinPolled();
+    }
+
+    // forget the period before micros() wraps around and fakes a new one
+    if (period != 0 && micros() - lastPulse > INPUT_PULSE_TIMEOUT) {
+        period = 0;
+    }
+    return busy;
+}
+
+bool BinaryInput::spinPolled() {
     bool busy = false;
     unsigned long now = millis();
     int value = digitalRead(pin);
@@ -23,7 +51,7 @@ bool BinaryInput::spin() {
 
         case InputState::DEBOUNCE_ON:
             if (now - ts > debounceInterval) {
-                state = InputState::ON;
+                accept(true, micros());
                 busy = true;
             }
             break;
@@ -38,7 +66,7 @@ bool BinaryInput::spin() {
 
         case InputState::DEBOUNCE_OFF:
             if (now - ts > debounceInterval) {
-                state = InputState::OFF;
+                accept(false, micros());
                 busy = true;
             }
             break;
@@ -46,6 +74,71 @@ bool BinaryInput::spin() {
     return busy;
 }
 
+bool BinaryInput::spinInterrupt() {
+    bool busy = false;
+    uint32_t edge;
+
+    while (edgeBuffer.pop(edge)) {
+        // the previous level held until this edge, it may have been long enough
+        settle(edge & ~1UL);
+        rawLevel = edge & 1;
+        rawTs = edge & ~1UL;
+        busy = true;
+    }
+
+    if (edgeBuffer.overflow) {
+        // edges were dropped, trust the pin from now on
+        edgeBuffer.overflow = false;
+        rawLevel = digitalRead(pin);
+        rawTs = micros();
+        busy = true;
+    }
+
+    settle(micros());
+    return busy;
+}
+
+// accept the raw level if it has held for the debounce interval until now
+void BinaryInput::settle(unsigned long now) {
+    bool on = rawLevel == LOW;
+    if (on == getState()) return;
+    if (now - rawTs < debounceInterval * 1000UL) return;
+    accept(on, rawTs);
+}
+
+void BinaryInput::accept(bool on, unsigned long at) {
+    state = on ? InputState::ON : InputState::OFF;
+    changed();
+    DEVICE_COUNT(edges);
+    // when the edge happened, not when it was debounced, a bank logs its own channels
+    if (mode != InputMode::BANKED) {
+        EVENT_LOG(this, 0, on, millis() - (micros() - at) / 1000UL);
+    }
+
+    if (!on) return;
+    if (pulses != 0) {
+        period = at - lastPulse;
+    }
+    lastPulse = at;
+    pulses++;
+}
+
+void BinaryInput::update(bool on) {
+    if (on != getState()) accept(on, micros());
+}
+
+unsigned long BinaryInput::nextSpin() {
+    // only the pulse period expires, the bank does the sampling
+    if (mode == InputMode::BANKED) return INPUT_PULSE_TIMEOUT / 1000;
+    // edges are timestamped by the ISR, late spins do not shift the debounce
+    if (mode == InputMode::INTERRUPT) return INPUT_SAMPLE_INTERVAL;
+
+    if (state == InputState::DEBOUNCE_ON || state == InputState::DEBOUNCE_OFF) {
+        return remaining(ts, debounceInterval);
+    }
+    return INPUT_SAMPLE_INTERVAL;
+}
+
 void BinaryInput::get(setValue &value) {
     value.b = getState();
 }
@@ -54,6 +147,19 @@ bool BinaryInput::getState() {
     return state == InputState::ON || state == InputState::DEBOUNCE_OFF;
 }
 
+uint32_t BinaryInput::getPulses() {
+    return pulses;
+}
+
+uint32_t BinaryInput::getFrequency() {
+    if (period == 0) return 0;
+
+    // a pulse overdue by more than the last period lowers the estimate
+    unsigned long elapsed = micros() - lastPulse;
+    unsigned long p = elapsed > period ? elapsed : period;
+    return 1000000000UL / p;
+}
+
 unsigned int BinaryInput::serialize(char *s, size_t len) {
 
     //if no place to write
@@ -64,3 +170,10 @@ unsigned int BinaryInput::serialize(char *s, size_t len) {
     return 1; 
 }
 
+#ifdef USE_METRICS
+bool BinaryInput::getCounter(DeviceCounter counter, uint32_t &value) {
+    if (counter != DeviceCounter::INPUT_EDGES) return false;
+    value = edges;
+    return true;
+}
+#endif // USE_METRICS
@@ -3,6 +3,11 @@
 
 #include <Arduino.h>
 #include "device.h"
+#include "pinChange.h"
+
+#define INPUT_SAMPLE_INTERVAL 1 // ms between samples of a settled input
+#define INPUT_PULSE_DEBOUNCE 5  // ms a level must hold in interrupt mode, S0 pulses are >= 30 ms
+#define INPUT_PULSE_TIMEOUT 60000000UL // us without a pulse before the frequency reads 0
 
 enum class InputState {
     OFF,
@@ -11,20 +16,57 @@ enum class InputState {
     DEBOUNCE_OFF
 };
 
+enum class InputMode {
+    POLLED,     // digitalRead every INPUT_SAMPLE_INTERVAL
+    INTERRUPT,  // edges timestamped by the pin change interrupt
+    BANKED      // debounced levels fed by an InputBank
+};
+
 class BinaryInput : public Device {
     private:
         int pin;
         unsigned long ts;
         unsigned long debounceInterval = 50;
         InputState state = InputState::OFF;
+        InputMode mode = InputMode::POLLED;
+
+        // interrupt mode
+        EdgeBuffer edgeBuffer;
+        uint8_t rawLevel = HIGH;    // pin level after the last queued edge
+        unsigned long rawTs = 0;    // micros() of the last queued edge
+
+        // pulses are counted on every debounced OFF -> ON edge
+        uint32_t pulses = 0;
+        unsigned long lastPulse = 0; // micros() of the last pulse
+        unsigned long period = 0;    // us between the last two pulses, 0 if unknown
+#ifdef USE_METRICS
+        uint32_t edges = 0; // debounced edges in both directions
+#endif // USE_METRICS
 
         bool getState();
+        bool spinPolled();
+        bool spinInterrupt();
+        void settle(unsigned long now);
+        void accept(bool on, unsigned long at);
     public:
-        BinaryInput(String _name, int _pin);
+        BinaryInput(String _name, int _pin, InputMode _mode = InputMode::POLLED);
         bool spin() override;
+        unsigned long nextSpin() override;
         void get(setValue &value) override;
         unsigned int serialize(char *s, size_t len) override;
         setValueType getType() override { return setValueType::BOOL; }
+
+        int getPin() { return pin; }
+        // Debounced level from an InputBank, banked inputs do not sample the pin
+        void update(bool on);
+
+        // Debounced pulses since start, wraps around at 2^32
+        uint32_t getPulses();
+        // Pulses per 1000 s (mHz) from the last pulse period, decays while no pulse comes
+        uint32_t getFrequency();
+#ifdef USE_METRICS
+        bool getCounter(DeviceCounter counter, uint32_t &value) override;
+#endif // USE_METRICS
 };
 
-#endif
\ No newline at end of file
+#endif
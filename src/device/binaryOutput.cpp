@@ -1,4 +1,5 @@
 #include "binaryOutput.h"
+#include "eventLog.h"
 
 BinaryOutput::BinaryOutput(String _name, int _pin) {
     strncpy(name, _name.c_str(), MAX_NAME_SIZE - 1);
@@ -16,6 +17,10 @@ void BinaryOutput::get(setValue& value) {
 }
 
 setterOutput BinaryOutput::set(const setValue& value) {
+    if (state != value.b) {
+        changed();
+        EVENT_LOG(this, 0, value.b, millis());
+    }
     state = value.b;
     digitalWrite(pin, state);
     ts = millis();
@@ -13,7 +13,9 @@ class BinaryOutput : public Device {
     public:
         BinaryOutput(String _name, int _pin);
         bool spin() override;
+        unsigned long nextSpin() override { return TASK_IDLE; }
         setterOutput set(const setValue &value) override;
+        setterOutput canSet(const setValue &) override { return setterOutput::OK; }
         void get(setValue &value) override;
         unsigned int serialize(char *s, size_t len) override;
         setterOutput deserialize(char *s, size_t len) override;
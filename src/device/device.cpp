@@ -0,0 +1,42 @@
+#include "device.h"
+
+unsigned long Device::sequence = 0;
+
+// single value devices only have channel 0
+uint8_t Device::getMany(uint8_t first, uint8_t count, setValue *values) {
+    if (first != 0 || count == 0) return 0;
+    get(values[0]);
+    return 1;
+}
+
+setterOutput Device::canSetMany(uint8_t first, uint8_t count, const setValue *values) {
+    if (first != 0 || count != 1) return setterOutput::NOT_SUPPORTED;
+    return canSet(values[0]);
+}
+
+setterOutput Device::setMany(uint8_t first, uint8_t count, const setValue *values) {
+    if (first != 0 || count != 1) return setterOutput::NOT_SUPPORTED;
+    return set(values[0]);
+}
+
+bool Device::getFixed(uint8_t channel, int8_t exponent, int32_t &mantissa) {
+    setValue v;
+    if (!hasValue() || getMany(channel, 1, &v) != 1) return false;
+
+    switch (getChannelType(channel)) {
+        case setValueType::BOOL:
+            mantissa = fixedRescale(v.b ? 1 : 0, 0, exponent);
+            return true;
+        case setValueType::INT:
+            mantissa = fixedRescale(v.i, 0, exponent);
+            return true;
+        case setValueType::UINT32:
+            mantissa = fixedRescale(v.u > 2147483647UL ? 2147483647L : static_cast<int32_t>(v.u), 0, exponent);
+            return true;
+        case setValueType::FIXED:
+            mantissa = fixedRescale(v.x.mantissa, v.x.exponent, exponent);
+            return true;
+        default:
+            return false; // no device serves floats or strings here
+    }
+}
@@ -3,16 +3,24 @@
 
 #include <Arduino.h>
 
+#include "config.h"
+#include "task.h"
+#include "fixedPoint.h"
+
 union setValue {
     bool b;
     int i;
     float f;
+    uint32_t u;
+    FixedValue x;
 };
 
 enum class setValueType {
     BOOL,
     INT,
     FLOAT,
+    UINT32,
+    FIXED,      // FixedValue, integer mantissa and decimal exponent
     STRING
 };
 
@@ -26,23 +34,70 @@ enum class setterOutput {
 
 #define MAX_NAME_SIZE 16
 
-class Device {
+#ifdef USE_METRICS
+// Per device counters exported on GET /metrics
+enum class DeviceCounter {
+    INPUT_EDGES,        // debounced edges of a binary input
+    SENSOR_ERRORS,      // failed sensor conversions
+    SENSOR_RECONNECTS   // sensor bus restarts after an error
+};
+    #define DEVICE_COUNT(x) (x++)
+#else
+    #define DEVICE_COUNT(x)
+#endif // USE_METRICS
+
+class Device : public Task {
+private:
+    static unsigned long sequence; // Global change sequence, shared by all devices
+    unsigned long version = 0; // Sequence number of the last change of this device
+
 protected:
     char name[MAX_NAME_SIZE] = "Unnamed";
+
+    // Call whenever the published value changes
+    void changed() { version = ++sequence; }
+
 public:
-    virtual bool spin() = 0;
     virtual setValueType getType() = 0;
     virtual unsigned int serialize(char *s, size_t len) = 0;
     
     virtual void get(setValue&) {};
-    virtual const char* getName() { return name; }
+    // false while get() has no valid reading, e.g. a disconnected sensor
+    virtual bool hasValue() { return true; }
+    const char* getName() override { return name; }
+
+    // Sequence number of the last change, 0 if never changed
+    unsigned long getVersion() { return version; }
+    // Sequence number of the latest change of any device
+    static unsigned long getSequence() { return sequence; }
     virtual setterOutput set(const setValue&) { 
         return setterOutput::NOT_SUPPORTED; 
     };
+    // check if set() would accept the value, without applying it
+    virtual setterOutput canSet(const setValue&) {
+        return setterOutput::NOT_SUPPORTED;
+    };
     virtual setterOutput deserialize(char *s, size_t len) {
         return setterOutput::NOT_SUPPORTED;
     }
 
+    // Batch access, channel 0 is the value of get() and set(). Devices
+    // owning several values override these to serve a block in one call.
+    virtual uint8_t getChannelCount() { return 1; }
+    virtual setValueType getChannelType(uint8_t) { return getType(); }
+    // Read count channels from first, returns the number of channels read
+    virtual uint8_t getMany(uint8_t first, uint8_t count, setValue *values);
+    // check if setMany() would accept all the values, without applying them
+    virtual setterOutput canSetMany(uint8_t first, uint8_t count, const setValue *values);
+    virtual setterOutput setMany(uint8_t first, uint8_t count, const setValue *values);
+    // Channel as a decimal mantissa at the exponent, rounded and saturated.
+    // False for float and string values or without a valid reading.
+    bool getFixed(uint8_t channel, int8_t exponent, int32_t &mantissa);
+#ifdef USE_METRICS
+    // false if the device does not keep this counter
+    virtual bool getCounter(DeviceCounter, uint32_t&) { return false; }
+#endif // USE_METRICS
+
     virtual ~Device() {}
 };
 
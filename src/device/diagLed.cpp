@@ -7,16 +7,18 @@ DiagLed::DiagLed(int _pin) {
 }
 
 bool DiagLed::spin() {
-    bool busy = false;
-
     unsigned long now = millis();
-    if (now - ts > blinkInterval) {
+    if (state && now - ts > blinkInterval) {
         state = false;
         digitalWrite(pin, LOW);
         ts = now;
-        busy = true;
     }
-    return busy;
+    // switching the LED off is not reported as busy, it would blink again
+    return false;
+}
+
+unsigned long DiagLed::nextSpin() {
+    return state ? remaining(ts, blinkInterval) : TASK_IDLE;
 }
 
 void DiagLed::blink() {
@@ -3,7 +3,9 @@
 
 #include <Arduino.h>
 
-class DiagLed {
+#include "task.h"
+
+class DiagLed : public Task {
     private:
         int pin;
         unsigned long ts;
@@ -12,7 +14,9 @@ class DiagLed {
 
     public:
         DiagLed(int pin);
-        bool spin();
+        bool spin() override;
+        unsigned long nextSpin() override;
+        const char* getName() override { return "led"; }
         void blink();
 };
 
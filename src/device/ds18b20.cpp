@@ -1,68 +1,70 @@
 #include "ds18b20.h"
 
-DS18B20::DS18B20(String _name, int _pin) {
+DS18B20::DS18B20(String _name, OneWireBus *bus, uint8_t _resolution, const uint8_t *rom) {
     strncpy(name, _name.c_str(), MAX_NAME_SIZE - 1);
-    pin = _pin;
-    oneWire = OneWire(pin);
-    sensor = DallasTemperature(&oneWire);
-
-    sensor.setWaitForConversion(false);
-    sensor.begin();
-
+    resolution = constrain(_resolution, 9, 12);
+    if (rom != nullptr) learn(rom);
+    bus->attach(this);
 }
 
-bool DS18B20::spin() {
-    bool busy = false;
-    unsigned long now = millis();
-
-    switch (state) {
-        case DS18B20State::STARTING:
-        case DS18B20State::IDLE:
-            if (now - ts > readInterval) {
-                state = DS18B20State::PENDING;
-                sensor.requestTemperatures();
-                ts = now;
-                busy = true;
-            }
-            break;
+void DS18B20::learn(const uint8_t *rom) {
+    memcpy(address, rom, sizeof(address));
+    known = true;
+}
 
-        case DS18B20State::PENDING:
-            if (now - ts > pendingInterval) {
-                float t = sensor.getTempCByIndex(0);
-                if (t == DEVICE_DISCONNECTED_C) {
-                    state = DS18B20State::ERROR;
-                } else {
-                    temperature = t;
-                    state = DS18B20State::IDLE;
-                }
-                ts = now;
-                busy = true;
-            }
-            break;
+void DS18B20::setPresent(bool _present) {
+    present = _present;
+    if (!present && valid) {
+        valid = false;
+        changed(); // serialized as null from now
+    }
+}
 
-        case DS18B20State::ERROR:
-            //reconnect
-            if (now - ts > reconnectInterval) {
-                state = DS18B20State::IDLE;
-                sensor.begin();
-                ts = now;
-                busy = true;
-            }
-            break;
+bool DS18B20::update(int16_t t) {
+    if (t == DEVICE_DISCONNECTED_RAW) {
+        if (valid) changed(); // serialized as null from now
+        valid = false;
+        DEVICE_COUNT(errors);
+        return false;
     }
-    return busy;
+    delta = valid ? abs(t - raw) : 0;
+    if (!valid || t != raw) changed();
+    raw = t;
+    valid = true;
+    return true;
+}
+
+void DS18B20::reconnected() {
+    DEVICE_COUNT(reconnects);
 }
 
 void DS18B20::get(setValue &value) {
-    value.f = temperature;
+    // 1/16 C is exactly 625 * 10^-4 C
+    value.x.mantissa = raw * 625L;
+    value.x.exponent = -4;
 }
 
 unsigned int DS18B20::serialize(char *s, size_t len) {
-    if (state == DS18B20State::ERROR || state == DS18B20State::STARTING) {
+    if (!valid) {
         snprintf(s,len,"null");
     } else {
-        dtostrf(temperature,3,2,s);
+        setValue value;
+        get(value);
+        fixedFormat(s, len, value.x, 2);
     }
 
     return strlen(s);
-}
\ No newline at end of file
+}
+
+#ifdef USE_METRICS
+bool DS18B20::getCounter(DeviceCounter counter, uint32_t &value) {
+    if (counter == DeviceCounter::SENSOR_ERRORS) {
+        value = errors;
+    } else if (counter == DeviceCounter::SENSOR_RECONNECTS) {
+        value = reconnects;
+    } else {
+        return false;
+    }
+    return true;
+}
+#endif // USE_METRICS
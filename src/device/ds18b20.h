@@ -1,39 +1,51 @@
 #ifndef DS18B20_H
 #define DS18B20_H
 
-
-#include <OneWire.h>
-#include <DallasTemperature.h>
 #include <Arduino.h>
 
 #include "device.h"
+#include "oneWireBus.h"
 
-enum class DS18B20State {
-    STARTING,   // started but not data available yet
-    IDLE,
-    PENDING,    // waiting for the sensor to respond
-    ERROR
-};
-
+// One DS18B20 on a OneWireBus, the bus does all the 1-Wire traffic
 class DS18B20 : public Device {
     private:
-        OneWire oneWire;
-        DallasTemperature sensor;
-        int pin;
-        float temperature;
+        int16_t raw;         // last reading in 1/16 C, as sent by the sensor
+        bool valid = false; // temperature holds a successful reading
+        DeviceAddress address;
+        bool known = false;   // address holds the ROM of this sensor
+        bool present = false; // the ROM was found by the last search
+        uint8_t resolution;  // 9..12 bits, fewer bits convert faster
+        uint16_t delta = 0;  // change of the last reading, 1/16 C
+#ifdef USE_METRICS
+        uint32_t errors = 0;     // conversions without a valid reading
+        uint32_t reconnects = 0; // bus restarts after an error
+#endif // USE_METRICS
 
-        unsigned long ts;
-        unsigned long readInterval = 5000;
-        unsigned long pendingInterval = 750;
-        unsigned long reconnectInterval = 30000;
-        DS18B20State state = DS18B20State::STARTING;
-        
     public:
-        DS18B20(String _name, int _pin);
-        bool spin() override;
+        // Without a ROM the sensor learns one when the bus is searched, see OneWireBus
+        DS18B20(String _name, OneWireBus *bus, uint8_t _resolution = 12, const uint8_t *rom = nullptr);
+        bool spin() override { return false; }
+        unsigned long nextSpin() override { return TASK_IDLE; }
         void get(setValue &value) override;
+        bool hasValue() override { return valid; }
         unsigned int serialize(char *s, size_t len) override;
-        setValueType getType() override { return setValueType::FLOAT; }
+        setValueType getType() override { return setValueType::FIXED; }
+
+        // Called by the bus
+        bool isKnown() { return known; }
+        bool matches(const uint8_t *rom) { return memcmp(address, rom, sizeof(address)) == 0; }
+        void learn(const uint8_t *rom); // kept for the rest of the run
+        void setPresent(bool _present);
+        bool isPresent() { return present; }
+        const uint8_t* getAddress() { return address; }
+        uint8_t getResolution() { return resolution; }
+        uint16_t getDelta() { return delta; }
+        int16_t getRaw() { return raw; }
+        bool update(int16_t t); // 1/16 C, false if the reading failed (DEVICE_DISCONNECTED_RAW)
+        void reconnected();
+#ifdef USE_METRICS
+        bool getCounter(DeviceCounter counter, uint32_t &value) override;
+#endif // USE_METRICS
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,71 @@
+#include "fixedPoint.h"
+
+int32_t fixedRescale(int32_t mantissa, int8_t from, int8_t to) {
+    int32_t m = mantissa;
+
+    // more decimals, multiply and saturate
+    for (int8_t e = from; e > to; e--) {
+        if (m > 214748364L) return 2147483647L;
+        if (m < -214748364L) return -2147483647L - 1;
+        m *= 10;
+    }
+
+    // fewer decimals, divide and round the last digit
+    if (from < to) {
+        for (int8_t e = from; e < to - 1; e++) {
+            m /= 10;
+        }
+        int8_t last = m % 10;
+        m /= 10;
+        if (last >= 5) m++;
+        if (last <= -5) m--;
+    }
+    return m;
+}
+
+unsigned int fixedFormat(char *s, size_t len, const FixedValue &value, uint8_t decimals) {
+    int32_t m = fixedRescale(value.mantissa, value.exponent, -static_cast<int8_t>(decimals));
+
+    // digits are produced from the right, the sign goes in front
+    char buf[14];
+    uint8_t pos = sizeof(buf);
+    bool negative = m < 0;
+    uint32_t u = negative ? -static_cast<uint32_t>(m) : m;
+
+    buf[--pos] = '\0';
+    for (uint8_t d = 0; d <= decimals || u != 0; d++) {
+        if (d == decimals && decimals > 0) buf[--pos] = '.';
+        buf[--pos] = '0' + u % 10;
+        u /= 10;
+        if (pos <= 1) break;
+    }
+    if (negative) buf[--pos] = '-';
+
+    strncpy(s, &buf[pos], len);
+    if (len > 0) s[len - 1] = '\0';
+    return strlen(s);
+}
+
+#define FIXED_FLOAT_MAX_EXPONENT 9
+
+// 10^e for e = -9..9, a multiply is far cheaper than a soft-float divide
+static const float powersOfTen[2 * FIXED_FLOAT_MAX_EXPONENT + 1] PROGMEM = {
+    1e-9f, 1e-8f, 1e-7f, 1e-6f, 1e-5f, 1e-4f, 1e-3f, 1e-2f, 1e-1f,
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f
+};
+
+float fixedToFloat(const FixedValue &value) {
+    float f = value.mantissa;
+    int8_t e = value.exponent;
+
+    // exponents past the table take a few steps, no device produces them
+    while (e > FIXED_FLOAT_MAX_EXPONENT) {
+        f *= 1e9f;
+        e -= FIXED_FLOAT_MAX_EXPONENT;
+    }
+    while (e < -FIXED_FLOAT_MAX_EXPONENT) {
+        f *= 1e-9f;
+        e += FIXED_FLOAT_MAX_EXPONENT;
+    }
+    return f * pgm_read_float(&powersOfTen[e + FIXED_FLOAT_MAX_EXPONENT]);
+}
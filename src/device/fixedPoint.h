@@ -0,0 +1,23 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <Arduino.h>
+
+// Decimal fixed point number, value = mantissa * 10^exponent. Devices keep
+// their readings in it, so the AVR does not pull in soft-float for them.
+struct FixedValue {
+    int32_t mantissa;
+    int8_t exponent;
+};
+
+// mantissa of the same value with another exponent, rounded half away
+// from zero and saturated to the int32 range
+int32_t fixedRescale(int32_t mantissa, int8_t from, int8_t to);
+
+// print with the given number of decimals, returns the length like snprintf
+unsigned int fixedFormat(char *s, size_t len, const FixedValue &value, uint8_t decimals);
+
+// for FLOAT32 registers, the only place a fixed value becomes a float
+float fixedToFloat(const FixedValue &value);
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,69 @@
+#include "inputBank.h"
+#include "eventLog.h"
+
+InputBank::InputBank(String _name) {
+    strncpy(name, _name.c_str(), MAX_NAME_SIZE - 1);
+}
+
+bool InputBank::attach(BinaryInput *input) {
+    int pin = input->getPin();
+    volatile uint8_t *reg = portInputRegister(digitalPinToPort(pin));
+
+    if (count >= INPUT_BANK_SIZE) return false;
+    if (port != nullptr && reg != port) return false;
+
+    port = reg;
+    inputs[count] = input;
+    masks[count] = digitalPinToBitMask(pin);
+    used |= masks[count];
+    count++;
+    return true;
+}
+
+bool InputBank::spin() {
+    unsigned long now = millis();
+    if (port == nullptr || now - ts <= INPUT_BANK_TICK) return false;
+    ts = now;
+
+    // inputs are pulled up, a low level is active
+    uint8_t delta = (~*port & used) ^ debounced;
+
+    // count down every bit which differs from its debounced level,
+    // reset the counter of bits which agree
+    ct0 = ~(ct0 & delta);
+    ct1 = ct0 ^ (ct1 & delta);
+    uint8_t toggled = delta & ct0 & ct1; // counter rolled over
+
+    if (toggled == 0) return false;
+    debounced ^= toggled;
+    changed();
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (toggled & masks[i]) {
+            inputs[i]->update((debounced & masks[i]) != 0);
+            EVENT_LOG(this, i, (debounced & masks[i]) != 0, now);
+        }
+    }
+    return true;
+}
+
+uint8_t InputBank::getMany(uint8_t first, uint8_t n, setValue *values) {
+    uint8_t read = 0;
+    for (uint8_t ch = first; ch < count && read < n; ch++) {
+        values[read++].b = (debounced & masks[ch]) != 0;
+    }
+    return read;
+}
+
+// all levels comma separated, for debugging, the protocols serve the inputs
+unsigned int InputBank::serialize(char *s, size_t len) {
+    if (len < 1) return 0;
+
+    unsigned int n = 0;
+    for (uint8_t ch = 0; ch < count && n + 2 < len; ch++) {
+        if (ch > 0) s[n++] = ',';
+        s[n++] = (debounced & masks[ch]) ? '1' : '0';
+    }
+    s[n] = '\0';
+    return n;
+}
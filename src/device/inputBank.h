@@ -0,0 +1,44 @@
+#ifndef INPUT_BANK_H
+#define INPUT_BANK_H
+
+#include <Arduino.h>
+
+#include "device.h"
+#include "binaryInput.h"
+
+#define INPUT_BANK_SIZE 8       // Inputs of one bank, one port register
+#define INPUT_BANK_TICK 12      // ms between samples, a level must hold for 4 samples
+
+// Samples the inputs of one port with a single register read per tick and
+// debounces all of them at once with a 2 bit vertical counter. The inputs
+// stay ordinary named devices which count pulses from the debounced
+// levels. The bank also serves all levels as channels, in the order of
+// attach(), so Modbus nodes can read them in one getMany() call.
+class InputBank : public Device {
+    private:
+        volatile uint8_t *port = nullptr; // PINx register shared by all inputs
+        BinaryInput *inputs[INPUT_BANK_SIZE];
+        uint8_t masks[INPUT_BANK_SIZE];
+        uint8_t count = 0;
+        uint8_t used = 0;       // port bits of all inputs
+
+        uint8_t debounced = 0;  // 1 = input active (pulled low)
+        uint8_t ct0 = 0xFF;     // vertical counter, bit n counts port bit n
+        uint8_t ct1 = 0xFF;
+        unsigned long ts = 0;
+
+    public:
+        InputBank(String _name);
+        // false if the input is on another port than the bank or the bank is full
+        bool attach(BinaryInput *input);
+        bool spin() override;
+        unsigned long nextSpin() override { return remaining(ts, INPUT_BANK_TICK); }
+
+        setValueType getType() override { return setValueType::BOOL; }
+        void get(setValue &value) override { value.b = false; getMany(0, 1, &value); }
+        unsigned int serialize(char *s, size_t len) override;
+        uint8_t getChannelCount() override { return count; }
+        uint8_t getMany(uint8_t first, uint8_t n, setValue *values) override;
+};
+
+#endif // INPUT_BANK_H
@@ -0,0 +1,372 @@
+#include "oneWireBus.h"
+#include "ds18b20.h"
+
+#define DS18B20_FAMILY 0x28
+#define DS18B20_CONVERT 0x44
+#define DS18B20_READ_SCRATCHPAD 0xBE
+#define DS18B20_WRITE_SCRATCHPAD 0x4E
+#define DS18B20_COPY_SCRATCHPAD 0x48
+#define DS18B20_READ_POWER 0xB4
+#define ONE_WIRE_SKIP_ROM 0xCC
+#define ONE_WIRE_MATCH_ROM 0x55
+#define DS18B20_POWER_ON_RAW 0x0550 // 85 C, the scratchpad of a sensor which lost power
+
+OneWireBus::OneWireBus(int pin) : engine(pin) {
+    snprintf(name, sizeof(name), "1wire_%d", pin);
+}
+
+bool OneWireBus::attach(DS18B20 *sensor) {
+    if (sensorCount >= ONE_WIRE_MAX_SENSORS) return false;
+    sensors[sensorCount++] = sensor;
+    return true;
+}
+
+// search the bus one ROM per engine transaction, see the SEARCHING state
+void OneWireBus::startEnumerate() {
+    stored = 0;
+    total = 0;
+    engine.stop(); // end the strong pull-up
+    engine.startSearch(true);
+    state = OneWireBusState::SEARCHING;
+}
+
+// match the ROM codes found to the sensors
+void OneWireBus::matchRoms() {
+    bool claimed[ONE_WIRE_MAX_SENSORS] = {};
+
+    // a sensor with a known ROM is present only if that ROM answered
+    uint8_t unknown = 0;
+    uint8_t unclaimed = total;
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        bool present = false;
+        if (sensors[i]->isKnown()) {
+            for (uint8_t r = 0; r < stored && !present; r++) {
+                if (!claimed[r] && sensors[i]->matches(roms[r])) {
+                    claimed[r] = true;
+                    unclaimed--;
+                    present = true;
+                }
+            }
+        } else {
+            unknown++;
+        }
+        sensors[i]->setPresent(present);
+    }
+
+    // Sensors without a ROM learn the remaining ones in search order, but
+    // only when exactly as many are left: with a sensor missing or an extra
+    // one on the wire, the order would put a reading under the wrong name.
+    if (unknown > 0 && unclaimed == unknown && total <= ONE_WIRE_MAX_SENSORS) {
+        uint8_t r = 0;
+        for (uint8_t i = 0; i < sensorCount; i++) {
+            if (sensors[i]->isKnown()) continue;
+            while (claimed[r]) r++;
+            claimed[r] = true;
+            sensors[i]->learn(roms[r]);
+            sensors[i]->setPresent(true);
+        }
+    }
+
+    found = 0;
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        if (sensors[i]->isPresent()) found++;
+    }
+
+    // the bus waits for its slowest sensor
+    pendingInterval = 0;
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        if (!sensors[i]->isPresent()) continue;
+        unsigned long wait = 750UL >> (12 - sensors[i]->getResolution()); // 94 ms at 9 bit .. 750 ms at 12 bit
+        if (wait > pendingInterval) pendingInterval = wait;
+    }
+}
+
+// read the scratchpad of the next present sensor from i on, its resolution
+// is written only when it differs; done with the enumeration after the last
+void OneWireBus::startConfigure(uint8_t i, unsigned long now) {
+    current = nextPresent(i);
+    if (current < sensorCount) {
+        startRead();
+        state = OneWireBusState::CONFIG_READ;
+    } else {
+        finishEnumerate(now);
+    }
+}
+
+void OneWireBus::finishEnumerate(unsigned long now) {
+    engine.stop(); // end the strong pull-up of a copy
+    enumerated = now;
+    if (found > 0) {
+        state = OneWireBusState::IDLE;
+        ts = now - readInterval - 1; // read right away
+    } else {
+        state = OneWireBusState::ERROR;
+        ts = now;
+    }
+}
+
+// read often while the temperature moves and rarely while it is stable
+void OneWireBus::adaptInterval(uint16_t delta) {
+    if (delta >= ONE_WIRE_ADAPT_DELTA) {
+        readInterval /= 2;
+        if (readInterval < ONE_WIRE_MIN_INTERVAL) readInterval = ONE_WIRE_MIN_INTERVAL;
+    } else {
+        readInterval += readInterval / 4;
+        if (readInterval > ONE_WIRE_MAX_INTERVAL) readInterval = ONE_WIRE_MAX_INTERVAL;
+    }
+}
+
+// temperature of a scratchpad in 1/16 C, DEVICE_DISCONNECTED_RAW if it is corrupted
+int16_t OneWireBus::decode(const uint8_t *scratchpad) {
+    bool blank = true;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (scratchpad[i] != 0) blank = false;
+    }
+    if (blank || OneWire::crc8(scratchpad, 8) != scratchpad[8]) return DEVICE_DISCONNECTED_RAW;
+
+    int16_t raw = (scratchpad[1] << 8) | scratchpad[0];
+    uint8_t bits = 9 + ((scratchpad[4] >> 5) & 0x03);
+    raw &= ~((1 << (12 - bits)) - 1); // low bits are undefined below 12 bit
+    return raw;
+}
+
+// A sensor which lost power during a reset answers 85 C with a valid CRC.
+// It is only believed when the sensor was near 85 C before.
+bool OneWireBus::plausible(DS18B20 *sensor, int16_t t) {
+    if (t != DS18B20_POWER_ON_RAW) return true;
+    if (!sensor->hasValue()) return false;
+    int16_t last = sensor->getRaw();
+    return last >= DS18B20_POWER_ON_RAW - ONE_WIRE_POWER_ON_BAND &&
+           last <= DS18B20_POWER_ON_RAW + ONE_WIRE_POWER_ON_BAND;
+}
+
+// index of the first present sensor from i on, sensorCount if none
+uint8_t OneWireBus::nextPresent(uint8_t i) {
+    while (i < sensorCount && !sensors[i]->isPresent()) i++;
+    return i;
+}
+
+void OneWireBus::startReadAll() {
+    engine.stop(); // end the strong pull-up
+    current = nextPresent(0);
+    failed = 0;
+    delta = 0;
+    startRead();
+    state = OneWireBusState::READING;
+}
+
+// match ROM and read the scratchpad of the current sensor
+void OneWireBus::startRead() {
+    uint8_t cmd[ONE_WIRE_TX_SIZE];
+    cmd[0] = ONE_WIRE_MATCH_ROM;
+    memcpy(&cmd[1], sensors[current]->getAddress(), 8);
+    cmd[9] = DS18B20_READ_SCRATCHPAD;
+    engine.start(true, cmd, sizeof(cmd), ONE_WIRE_RX_SIZE);
+}
+
+void OneWireBus::finishRead() {
+    adaptInterval(delta);
+    // without a single answer the bus itself is broken
+    if (found == 0 || failed == found) {
+        state = OneWireBusState::ERROR;
+    } else {
+        state = OneWireBusState::IDLE;
+    }
+}
+
+bool OneWireBus::spin() {
+    bool busy = false;
+    unsigned long now = millis();
+
+    // one time slot per pass, the transaction result is handled below
+    if (engine.spin()) return true;
+
+    switch (state) {
+        case OneWireBusState::STARTING:
+            startEnumerate();
+            busy = true;
+            break;
+
+        case OneWireBusState::SEARCHING:
+            if (engine.getResult() == OneWireResult::DONE) {
+                const uint8_t *rom = engine.getData();
+                if (rom[0] == DS18B20_FAMILY && OneWire::crc8(rom, 7) == rom[7]) {
+                    if (stored < ONE_WIRE_MAX_SENSORS) memcpy(roms[stored++], rom, sizeof(DeviceAddress));
+                    if (total < 0xFF) total++;
+                }
+                if (engine.hasMoreRoms()) {
+                    engine.startSearch(false);
+                    busy = true;
+                    break;
+                }
+            }
+            // all ROMs found, or nobody answered
+            matchRoms();
+            {
+                // parasite powered sensors keep the line high, they cannot be polled
+                const uint8_t cmd[] = {ONE_WIRE_SKIP_ROM, DS18B20_READ_POWER};
+                engine.start(true, cmd, sizeof(cmd), 1);
+            }
+            state = OneWireBusState::CHECKING_POWER;
+            busy = true;
+            break;
+
+        case OneWireBusState::CHECKING_POWER:
+            // a parasite powered sensor answers the first read slot with 0
+            parasite = engine.getResult() == OneWireResult::DONE && (engine.getData()[0] & 0x01) == 0;
+            startConfigure(0, now);
+            busy = true;
+            break;
+
+        case OneWireBusState::CONFIG_READ: {
+            const uint8_t *scratchpad = engine.getData();
+            uint8_t config = ((sensors[current]->getResolution() - 9) << 5) | 0x1F;
+            if (engine.getResult() == OneWireResult::DONE &&
+                decode(scratchpad) != DEVICE_DISCONNECTED_RAW && scratchpad[4] != config) {
+                // the alarm bytes are written back unchanged
+                uint8_t cmd[ONE_WIRE_TX_SIZE];
+                cmd[0] = ONE_WIRE_MATCH_ROM;
+                memcpy(&cmd[1], sensors[current]->getAddress(), 8);
+                cmd[9] = DS18B20_WRITE_SCRATCHPAD;
+                cmd[10] = scratchpad[2];
+                cmd[11] = scratchpad[3];
+                cmd[12] = config;
+                engine.start(true, cmd, sizeof(cmd), 0);
+                state = OneWireBusState::CONFIG_WRITE;
+            } else {
+                startConfigure(current + 1, now); // already set, or not readable
+            }
+            busy = true;
+            break;
+        }
+
+        case OneWireBusState::CONFIG_WRITE: {
+            // keep the resolution over a power loss, parasite sensors copy on the strong pull-up
+            uint8_t cmd[10];
+            cmd[0] = ONE_WIRE_MATCH_ROM;
+            memcpy(&cmd[1], sensors[current]->getAddress(), 8);
+            cmd[9] = DS18B20_COPY_SCRATCHPAD;
+            engine.start(true, cmd, sizeof(cmd), 0, parasite);
+            state = OneWireBusState::CONFIG_COPY;
+            busy = true;
+            break;
+        }
+
+        case OneWireBusState::CONFIG_COPY:
+            ts = now;
+            state = OneWireBusState::CONFIG_SAVING;
+            break;
+
+        case OneWireBusState::CONFIG_SAVING:
+            if (now - ts > ONE_WIRE_COPY_TIME) {
+                startConfigure(current + 1, now);
+                busy = true;
+            }
+            break;
+
+        case OneWireBusState::IDLE:
+            if (found < sensorCount && now - enumerated > reconnectInterval) {
+                // look for the missing sensors while the others keep working
+                state = OneWireBusState::STARTING;
+                busy = true;
+            } else if (now - ts > readInterval) {
+                // skip ROM, all sensors convert at once, parasite sensors need the strong pull-up
+                const uint8_t cmd[] = {ONE_WIRE_SKIP_ROM, DS18B20_CONVERT};
+                engine.start(true, cmd, sizeof(cmd), 0, parasite);
+                state = OneWireBusState::CONVERTING;
+                busy = true;
+            }
+            break;
+
+        case OneWireBusState::CONVERTING:
+            if (engine.getResult() != OneWireResult::DONE) {
+                // nobody on the wire
+                for (uint8_t i = nextPresent(0); i < sensorCount; i = nextPresent(i + 1)) {
+                    sensors[i]->update(DEVICE_DISCONNECTED_RAW);
+                }
+                state = OneWireBusState::ERROR;
+            } else {
+                state = OneWireBusState::PENDING;
+            }
+            ts = now;
+            busy = true;
+            break;
+
+        case OneWireBusState::PENDING:
+            if (now - ts > pendingInterval) {
+                startReadAll(); // waited for the slowest sensor
+                busy = true;
+            } else if (!parasite) {
+                // a converting sensor answers read slots with 0
+                engine.start(false, nullptr, 0, 1);
+                state = OneWireBusState::POLLING;
+                busy = true;
+            }
+            break;
+
+        case OneWireBusState::POLLING:
+            if (engine.getData()[0] == 0 && now - ts <= pendingInterval) {
+                state = OneWireBusState::PENDING; // still converting
+                break;
+            }
+            startReadAll();
+            busy = true;
+            break;
+
+        case OneWireBusState::READING: {
+            int16_t t = DEVICE_DISCONNECTED_RAW;
+            if (engine.getResult() == OneWireResult::DONE) {
+                t = decode(engine.getData());
+            }
+            if (!plausible(sensors[current], t)) t = DEVICE_DISCONNECTED_RAW;
+            if (!sensors[current]->update(t)) {
+                failed++;
+            } else if (sensors[current]->getDelta() > delta) {
+                delta = sensors[current]->getDelta();
+            }
+
+            current = nextPresent(current + 1);
+            if (current < sensorCount) {
+                startRead();
+            } else {
+                finishRead();
+                ts = now;
+            }
+            busy = true;
+            break;
+        }
+
+        case OneWireBusState::ERROR:
+            //reconnect
+            if (now - ts > reconnectInterval) {
+                for (uint8_t i = 0; i < sensorCount; i++) {
+                    sensors[i]->reconnected();
+                }
+                state = OneWireBusState::STARTING;
+                busy = true;
+            }
+            break;
+    }
+    return busy;
+}
+
+unsigned long OneWireBus::nextSpin() {
+    if (!engine.isIdle()) return 0; // next time slot
+
+    switch (state) {
+        case OneWireBusState::IDLE:
+            return remaining(ts, readInterval);
+        case OneWireBusState::PENDING:
+            if (!parasite) {
+                unsigned long left = remaining(ts, pendingInterval);
+                return left < ONE_WIRE_POLL_INTERVAL ? left : ONE_WIRE_POLL_INTERVAL;
+            }
+            return remaining(ts, pendingInterval);
+        case OneWireBusState::CONFIG_SAVING:
+            return remaining(ts, ONE_WIRE_COPY_TIME);
+        case OneWireBusState::ERROR:
+            return remaining(ts, reconnectInterval);
+        default:
+            return 0;
+    }
+}
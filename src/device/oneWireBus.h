@@ -0,0 +1,87 @@
+#ifndef ONE_WIRE_BUS_H
+#define ONE_WIRE_BUS_H
+
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include <Arduino.h>
+
+#include "task.h"
+#include "oneWireEngine.h"
+
+#define ONE_WIRE_MAX_SENSORS 4  // DS18B20 devices served per bus
+#define ONE_WIRE_POLL_INTERVAL 10       // ms between conversion complete polls
+#define ONE_WIRE_MIN_INTERVAL 1000      // ms between reads while the temperature moves
+#define ONE_WIRE_MAX_INTERVAL 30000     // ms between reads while the temperature is stable
+#define ONE_WIRE_ADAPT_DELTA 4          // 1/16 C change between two reads which counts as moving (0.25 C)
+#define ONE_WIRE_POWER_ON_BAND 16       // 1/16 C a reading must be within to trust a following 85 C (1 C)
+#define ONE_WIRE_COPY_TIME 10           // ms the scratchpad takes to reach the EEPROM
+
+class DS18B20;
+
+enum class OneWireBusState {
+    STARTING,   // ROMs not enumerated yet
+    SEARCHING,  // one Search ROM pass per ROM on the wire
+    CHECKING_POWER, // asking whether a sensor is parasite powered
+    CONFIG_READ,    // reading the resolution of one sensor after another
+    CONFIG_WRITE,   // writing a changed resolution to the scratchpad
+    CONFIG_COPY,    // sending the copy of the scratchpad to the EEPROM
+    CONFIG_SAVING,  // waiting for the EEPROM write
+    IDLE,
+    CONVERTING, // sending the convert broadcast
+    PENDING,    // conversion running on all sensors
+    POLLING,    // reading a conversion complete slot
+    READING,    // reading the scratchpad of one sensor after another
+    ERROR       // no sensor answered, enumerate again later
+};
+
+// One 1-Wire bus with its DS18B20 sensors. The ROM codes are cached when
+// the bus is enumerated, one broadcast starts the conversion of every
+// sensor and each sensor is then read by its address. The enumeration,
+// conversions and reads all run on the non-blocking engine.
+class OneWireBus : public Task {
+    private:
+        OneWireEngine engine;
+        DS18B20 *sensors[ONE_WIRE_MAX_SENSORS];
+        uint8_t sensorCount = 0;    // sensors attached in code
+        uint8_t found = 0;          // attached sensors present on the wire
+        unsigned long enumerated = 0; // millis() of the last search
+        DeviceAddress roms[ONE_WIRE_MAX_SENSORS]; // DS18B20 ROMs found by the running search
+        uint8_t stored = 0;
+        uint8_t total = 0;          // DS18B20s on the wire, also those beyond the table
+
+        bool parasite = false;      // a sensor draws power from the data line, no polling
+        unsigned long ts = 0;
+        unsigned long readInterval = 5000;  // adapted after every read
+        unsigned long pendingInterval = 750; // conversion time of the slowest sensor
+        unsigned long reconnectInterval = 30000;
+        OneWireBusState state = OneWireBusState::STARTING;
+        char name[10];              // "1wire_<pin>", tasks are told apart by name
+
+        // progress of a read of all sensors
+        uint8_t current = 0;
+        uint8_t failed = 0;
+        uint16_t delta = 0; // largest change seen by this read, 1/16 C
+
+        void startEnumerate();
+        void matchRoms();
+        void startConfigure(uint8_t i, unsigned long now);
+        void finishEnumerate(unsigned long now);
+        uint8_t nextPresent(uint8_t i);
+        void startReadAll();
+        void startRead();
+        void finishRead();
+        static int16_t decode(const uint8_t *scratchpad);
+        static bool plausible(DS18B20 *sensor, int16_t t);
+        void adaptInterval(uint16_t delta);
+    public:
+        OneWireBus(int pin);
+        // Sensors created with a ROM only read that ROM. Those without one learn
+        // the ROMs left over in search order, once all of them are on the wire,
+        // and keep them; give the ROMs when several sensors share a bus.
+        bool attach(DS18B20 *sensor);
+        bool spin() override;
+        unsigned long nextSpin() override;
+        const char* getName() override { return name; }
+};
+
+#endif // ONE_WIRE_BUS_H
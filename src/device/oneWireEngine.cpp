@@ -0,0 +1,227 @@
+#include "oneWireEngine.h"
+
+OneWireEngine::OneWireEngine(int pin) {
+    uint8_t port = digitalPinToPort(pin);
+    input = portInputRegister(port);
+    mode = portModeRegister(port);
+    output = portOutputRegister(port);
+    mask = digitalPinToBitMask(pin);
+}
+
+// the line is open drain, low is an output driving 0, high is an input
+// held by the external pull-up. The read-modify-writes are guarded, an ISR
+// touching the same port must not be undone; callers may already be inside
+// a guarded section, so the interrupt flag is restored rather than set.
+void OneWireEngine::driveLow() {
+    uint8_t sreg = SREG;
+    cli();
+    *output &= ~mask;
+    *mode |= mask;
+    SREG = sreg;
+}
+
+void OneWireEngine::release() {
+    uint8_t sreg = SREG;
+    cli();
+    *mode &= ~mask;
+    *output &= ~mask;
+    SREG = sreg;
+}
+
+void OneWireEngine::drivePower() {
+    uint8_t sreg = SREG;
+    cli();
+    *output |= mask;
+    *mode |= mask;
+    SREG = sreg;
+}
+
+void OneWireEngine::stop() {
+    release();
+    power = false;
+    step = OneWireStep::IDLE;
+}
+
+bool OneWireEngine::start(bool reset, const uint8_t *data, uint8_t len, uint8_t readLen, bool _power) {
+    if (step != OneWireStep::IDLE) return false;
+    if (len > ONE_WIRE_TX_SIZE || readLen > ONE_WIRE_RX_SIZE) return false;
+
+    if (len > 0) memcpy(tx, data, len);
+    txLen = len;
+    rxLen = readLen;
+    memset(rx, 0, sizeof(rx));
+    searching = false;
+    power = _power;
+    begin(reset);
+    return true;
+}
+
+bool OneWireEngine::startSearch(bool first) {
+    if (step != OneWireStep::IDLE) return false;
+
+    // the ROM of the last pass stays in rx, bits before the discrepancy follow it
+    if (first) {
+        memset(rx, 0, sizeof(rx));
+        discrepancy = 0;
+    }
+    tx[0] = ONE_WIRE_SEARCH_ROM;
+    txLen = 1;
+    rxLen = 0;
+    lastZero = 0;
+    searching = true;
+    power = false;
+    begin(true);
+    return true;
+}
+
+void OneWireEngine::begin(bool reset) {
+    slot = 0;
+    result = OneWireResult::BUSY;
+
+    release(); // end the strong pull-up of the previous transaction
+    ts = micros();
+    wait = 0;
+    step = reset ? OneWireStep::RESET : OneWireStep::SLOTS;
+}
+
+void OneWireEngine::writeSlot(bool bit) {
+    if (bit) {
+        noInterrupts();
+        driveLow();
+        delayMicroseconds(6);
+        release();
+        interrupts();
+        wait = 64;
+    } else {
+        // a longer low caused by an interrupt is still a valid 0 (max 120 us),
+        // only the port accesses themselves are guarded
+        driveLow();
+        delayMicroseconds(60);
+        release();
+        wait = 10;
+    }
+}
+
+bool OneWireEngine::readSlot() {
+    noInterrupts();
+    driveLow();
+    delayMicroseconds(3);
+    release();
+    delayMicroseconds(10);
+    bool bit = (*input & mask) != 0;
+    interrupts();
+    wait = 53;
+    return bit;
+}
+
+// Slot n of a search pass, three per ROM bit: every device sends the bit
+// and its complement, the master writes the branch it takes and the devices
+// on the other branch drop out. False when no device answered.
+bool OneWireEngine::searchSlot(uint8_t n) {
+    uint8_t bit = n / 3;
+    uint8_t byteMask = 1 << (bit & 0x07);
+
+    switch (n % 3) {
+        case 0:
+            triplet = readSlot();
+            return true;
+        case 1:
+            triplet |= readSlot() << 1;
+            return triplet != 0x03;
+        default: {
+            bool branch;
+            if (triplet != 0x00) {
+                branch = triplet == 0x01; // all remaining devices agree
+            } else if (bit + 1 < discrepancy) {
+                branch = (rx[bit >> 3] & byteMask) != 0; // as in the last pass
+            } else {
+                branch = bit + 1 == discrepancy;
+            }
+            if (triplet == 0x00 && !branch) lastZero = bit + 1;
+
+            if (branch) {
+                rx[bit >> 3] |= byteMask;
+            } else {
+                rx[bit >> 3] &= ~byteMask;
+            }
+            writeSlot(branch);
+            return true;
+        }
+    }
+}
+
+bool OneWireEngine::spin() {
+    if (step == OneWireStep::IDLE) return false;
+    if (micros() - ts < wait) return true; // recovery time of the last slot
+
+    switch (step) {
+        case OneWireStep::RESET:
+            // 480..960 us is a valid reset, the scheduler passes in between
+            // stretch it. A much longer low starves parasite powered sensors,
+            // which then answer 85 C, see OneWireBus::plausible().
+            driveLow();
+            ts = micros();
+            wait = 480;
+            step = OneWireStep::RESET_RELEASE;
+            return true;
+
+        case OneWireStep::RESET_RELEASE: {
+            // the presence pulse starts 15-60 us after the release, sample inside it
+            noInterrupts();
+            release();
+            delayMicroseconds(70);
+            bool present = (*input & mask) == 0;
+            interrupts();
+            ts = micros();
+
+            if (!present) {
+                result = OneWireResult::NO_PRESENCE;
+                step = OneWireStep::IDLE;
+                return false;
+            }
+            wait = 410;
+            step = OneWireStep::RESET_RECOVER;
+            return true;
+        }
+
+        case OneWireStep::RESET_RECOVER:
+            step = OneWireStep::SLOTS;
+            // fall through
+
+        case OneWireStep::SLOTS: {
+            uint8_t txSlots = txLen * 8;
+            uint8_t slots = txSlots + (searching ? ONE_WIRE_SEARCH_SLOTS : rxLen * 8);
+
+            if (slot >= slots) {
+                if (searching) discrepancy = lastZero;
+                result = OneWireResult::DONE;
+                step = OneWireStep::IDLE;
+                return false;
+            }
+
+            if (slot < txSlots) {
+                writeSlot((tx[slot >> 3] >> (slot & 0x07)) & 0x01);
+            } else if (searching) {
+                if (!searchSlot(slot - txSlots)) {
+                    result = OneWireResult::NO_PRESENCE;
+                    step = OneWireStep::IDLE;
+                    return false;
+                }
+            } else {
+                uint8_t n = slot - txSlots;
+                if (readSlot()) rx[n >> 3] |= 1 << (n & 0x07);
+            }
+            slot++;
+            ts = micros();
+
+            if (power && slot == slots) {
+                // strong pull-up within 10 us of the last bit, while the sensors convert
+                drivePower();
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef ONE_WIRE_ENGINE_H
+#define ONE_WIRE_ENGINE_H
+
+#include <Arduino.h>
+
+#define ONE_WIRE_TX_SIZE 13 // Match ROM, 8 ROM bytes, Write Scratchpad and its 3 bytes
+#define ONE_WIRE_RX_SIZE 9  // DS18B20 scratchpad
+#define ONE_WIRE_SEARCH_ROM 0xF0
+#define ONE_WIRE_SEARCH_SLOTS (64 * 3) // bit, complement and branch of every ROM bit
+
+enum class OneWireResult {
+    BUSY,
+    DONE,
+    NO_PRESENCE     // nobody answered the reset
+};
+
+enum class OneWireStep {
+    IDLE,
+    RESET,          // start of the reset pulse, the line goes low
+    RESET_RELEASE,  // 480 us later, release and sample the presence pulse
+    RESET_RECOVER,  // presence sampled, 410 us until the first slot
+    SLOTS           // one bit per step, LSB first
+};
+
+// 1-Wire master which runs a transaction one time slot per spin(), so the
+// caller yields between bits. The reset low is timed across spins, the
+// longest spin is the 70 us wait for the presence sample. Interrupts are
+// disabled only for the short timed edges and the port accesses.
+class OneWireEngine {
+    private:
+        volatile uint8_t *input;
+        volatile uint8_t *mode;
+        volatile uint8_t *output;
+        uint8_t mask;
+
+        uint8_t tx[ONE_WIRE_TX_SIZE];
+        uint8_t txLen = 0;
+        uint8_t rx[ONE_WIRE_RX_SIZE];
+        uint8_t rxLen = 0;
+        uint8_t slot = 0;       // bit of the transaction done next
+        bool power = false;     // drive the line high after the last slot
+        bool searching = false; // search ROM triplets follow the command
+        uint8_t discrepancy = 0; // ROM bit the next search takes the 1 branch at, 1-based
+        uint8_t lastZero = 0;   // last ROM bit the running search took the 0 branch at
+        uint8_t triplet = 0;    // bit and complement read for the current ROM bit
+
+        OneWireStep step = OneWireStep::IDLE;
+        OneWireResult result = OneWireResult::DONE;
+        unsigned long ts = 0;   // micros() of the last line change
+        unsigned long wait = 0; // us the line needs before the next step
+
+        void driveLow();
+        void release();
+        void drivePower();
+        void writeSlot(bool bit);
+        bool readSlot();
+        void begin(bool reset);
+        bool searchSlot(uint8_t n);
+    public:
+        OneWireEngine(int pin);
+
+        // Queue a transaction: optional reset, write tx, then read rxLen bytes.
+        // power keeps the line driven high afterwards for parasite sensors.
+        bool start(bool reset, const uint8_t *data, uint8_t len, uint8_t readLen, bool _power = false);
+        // Queue one pass of the Search ROM algorithm. The ROM found is left in
+        // getData(), the next pass continues from it unless first is set.
+        bool startSearch(bool first);
+        // After a search: false when the ROM found was the last one on the wire
+        bool hasMoreRoms() { return discrepancy != 0; }
+        // Advance by at most one time slot, false when the transaction is over
+        bool spin();
+        bool isIdle() { return step == OneWireStep::IDLE; }
+        OneWireResult getResult() { return result; }
+        const uint8_t* getData() { return rx; }
+        // Abort the transaction and release the line, ends a strong pull-up too
+        void stop();
+};
+
+#endif // ONE_WIRE_ENGINE_H
@@ -0,0 +1,62 @@
+#include "pinChange.h"
+
+struct PinChangeSlot {
+    volatile uint8_t *input;    // PINx register of the port
+    uint8_t mask;               // bit of the pin in the port
+    uint8_t vector;             // PCINTn vector serving the pin
+    uint8_t level;              // last level seen by the ISR
+    EdgeBuffer *buffer;
+};
+
+static PinChangeSlot slots[PIN_CHANGE_MAX_INPUTS];
+static uint8_t slotCount = 0;
+
+// runs with interrupts disabled, keep it short
+static void pinChangeIsr(uint8_t vector) {
+    uint32_t now = micros() & ~1UL;
+
+    for (uint8_t i = 0; i < slotCount; i++) {
+        PinChangeSlot &slot = slots[i];
+        if (slot.vector != vector) continue;
+
+        uint8_t level = (*slot.input & slot.mask) ? 1 : 0;
+        if (level == slot.level) continue; // another pin of the port changed
+
+        slot.level = level;
+        slot.buffer->push(now | level);
+    }
+}
+
+bool PinChange::attach(int pin, EdgeBuffer *buffer) {
+    volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+    if (pcicr == nullptr || slotCount >= PIN_CHANGE_MAX_INPUTS) return false;
+
+    PinChangeSlot &slot = slots[slotCount];
+    slot.input = portInputRegister(digitalPinToPort(pin));
+    slot.mask = digitalPinToBitMask(pin);
+    slot.vector = digitalPinToPCICRbit(pin);
+    slot.level = (*slot.input & slot.mask) ? 1 : 0;
+    slot.buffer = buffer;
+
+    // publish the slot before its interrupt can fire
+    uint8_t sreg = SREG;
+    cli();
+    slotCount++;
+    *digitalPinToPCMSK(pin) |= 1 << digitalPinToPCMSKbit(pin);
+    *pcicr |= 1 << digitalPinToPCICRbit(pin);
+    SREG = sreg;
+    return true;
+}
+
+#ifdef PCINT0_vect
+ISR(PCINT0_vect) { pinChangeIsr(0); }
+#endif
+#ifdef PCINT1_vect
+ISR(PCINT1_vect) { pinChangeIsr(1); }
+#endif
+#ifdef PCINT2_vect
+ISR(PCINT2_vect) { pinChangeIsr(2); }
+#endif
+#ifdef PCINT3_vect
+ISR(PCINT3_vect) { pinChangeIsr(3); }
+#endif
@@ -0,0 +1,45 @@
+#ifndef PIN_CHANGE_H
+#define PIN_CHANGE_H
+
+#include <Arduino.h>
+
+#define EDGE_BUFFER_SIZE 8          // Edges queued per input between two spins, power of two
+#define PIN_CHANGE_MAX_INPUTS 8     // Inputs watched by pin change interrupts
+
+// Lock-free single producer (ISR) / single consumer (spin) queue of edges.
+// micros() is a multiple of 4 on 16 MHz AVR, so bit 0 carries the pin
+// level after the edge.
+struct EdgeBuffer {
+    volatile uint32_t edge[EDGE_BUFFER_SIZE];
+    volatile uint8_t head = 0;      // written only by the ISR
+    volatile uint8_t tail = 0;      // written only by the consumer
+    volatile bool overflow = false; // edges were dropped, level must be resynced
+
+    // ISR side
+    void push(uint32_t e) {
+        uint8_t next = (head + 1) & (EDGE_BUFFER_SIZE - 1);
+        if (next == tail) {
+            overflow = true;
+            return;
+        }
+        edge[head] = e;
+        head = next;
+    }
+
+    // consumer side, the slot at tail is never written while it is queued
+    bool pop(uint32_t &e) {
+        if (tail == head) return false;
+        e = edge[tail];
+        tail = (tail + 1) & (EDGE_BUFFER_SIZE - 1);
+        return true;
+    }
+};
+
+class PinChange {
+    public:
+        // Queue every level change of the pin, false if the pin has no
+        // pin change interrupt or all slots are taken
+        static bool attach(int pin, EdgeBuffer *buffer);
+};
+
+#endif // PIN_CHANGE_H
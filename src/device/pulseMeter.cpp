@@ -0,0 +1,49 @@
+#include "pulseMeter.h"
+
+PulseMeter::PulseMeter(String _name, BinaryInput *_input, PulseQuantity _quantity) {
+    strncpy(name, _name.c_str(), MAX_NAME_SIZE - 1);
+    input = _input;
+    quantity = _quantity;
+    published.x.mantissa = 0;
+    published.x.exponent = quantity == PulseQuantity::COUNT ? 0 : -3;
+}
+
+bool PulseMeter::spin() {
+    unsigned long now = millis();
+    if (now - ts < PULSE_PUBLISH_INTERVAL) return false;
+    ts = now;
+
+    setValue value;
+    get(value);
+    if (quantity == PulseQuantity::COUNT ? value.u == published.u :
+                                           value.x.mantissa == published.x.mantissa) {
+        return false;
+    }
+    published = value;
+    changed();
+    return true;
+}
+
+void PulseMeter::get(setValue &value) {
+    if (quantity == PulseQuantity::COUNT) {
+        value.u = input->getPulses();
+    } else {
+        value.x.mantissa = input->getFrequency();
+        value.x.exponent = -3;
+    }
+}
+
+setValueType PulseMeter::getType() {
+    return quantity == PulseQuantity::COUNT ? setValueType::UINT32 : setValueType::FIXED;
+}
+
+// the value of the last change, not a live one: the frequency decays with
+// micros(), so two serializations of one response could differ in length
+unsigned int PulseMeter::serialize(char *s, size_t len) {
+    if (quantity == PulseQuantity::COUNT) {
+        snprintf(s, len, "%lu", static_cast<unsigned long>(published.u));
+    } else {
+        fixedFormat(s, len, published.x, 3);
+    }
+    return strlen(s);
+}
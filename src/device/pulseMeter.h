@@ -0,0 +1,33 @@
+#ifndef PULSE_METER_H
+#define PULSE_METER_H
+
+#include <Arduino.h>
+#include "device.h"
+#include "binaryInput.h"
+
+#define PULSE_PUBLISH_INTERVAL 1000 // ms between change checks of the published value
+
+enum class PulseQuantity {
+    COUNT,      // pulses since start, UINT32
+    FREQUENCY   // pulses per second, FIXED with 3 decimals
+};
+
+// Read-only view of the pulse counter of a binary input, so the counter
+// and the frequency are served like any other device value
+class PulseMeter : public Device {
+    private:
+        BinaryInput *input;
+        PulseQuantity quantity;
+        setValue published; // value of the last change notification
+        unsigned long ts = 0;
+
+    public:
+        PulseMeter(String _name, BinaryInput *_input, PulseQuantity _quantity);
+        bool spin() override;
+        unsigned long nextSpin() override { return remaining(ts, PULSE_PUBLISH_INTERVAL); }
+        void get(setValue &value) override;
+        unsigned int serialize(char *s, size_t len) override;
+        setValueType getType() override;
+};
+
+#endif // PULSE_METER_H
@@ -0,0 +1,29 @@
+#include "eventLog.h"
+
+#ifdef USE_EVENT_LOG
+
+EventLog eventLog;
+
+void EventLog::record(Device *dev, uint8_t channel, bool on, unsigned long ms) {
+    if (count == EVENT_LOG_SIZE) {
+        // readers which are behind see the gap in the sequence numbers
+        head = (head + 1) % EVENT_LOG_SIZE;
+        count--;
+        first++;
+    }
+
+    DeviceEvent &event = events[(head + count) % EVENT_LOG_SIZE];
+    event.dev = dev;
+    event.channel = channel;
+    event.ms = ms;
+    event.on = on;
+    count++;
+}
+
+const DeviceEvent* EventLog::at(uint16_t seq) {
+    uint16_t offset = seq - first;
+    if (offset >= count) return nullptr;
+    return &events[(head + offset) % EVENT_LOG_SIZE];
+}
+
+#endif // USE_EVENT_LOG
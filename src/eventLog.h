@@ -0,0 +1,48 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "config.h"
+#include <Arduino.h>
+
+#ifdef USE_EVENT_LOG
+
+#include "device/device.h"
+
+#define EVENT_LOG_SIZE 16   // events kept, the oldest is overwritten by a new one
+
+struct DeviceEvent {
+    Device *dev;
+    uint8_t channel;
+    unsigned long ms;   // millis() of the change
+    bool on;            // level after the change
+};
+
+// Bounded log of binary input edges and relay changes, so changes between
+// two polls are not lost. Filled from the device spin() and set() calls.
+// Reads do not remove anything: every event has a sequence number and each
+// reader asks for the events from the one it has not seen yet, so several
+// readers and repeated requests all see the complete log.
+class EventLog {
+    private:
+        DeviceEvent events[EVENT_LOG_SIZE];
+        uint8_t head = 0;   // oldest event
+        uint8_t count = 0;
+        uint16_t first = 0; // sequence number of the oldest event, wraps around
+
+    public:
+        void record(Device *dev, uint8_t channel, bool on, unsigned long ms);
+        uint16_t getFirst() { return first; }
+        // sequence number the next event will get
+        uint16_t getNext() { return first + count; }
+        // The event with the sequence number, nullptr if it is not held
+        const DeviceEvent* at(uint16_t seq);
+};
+
+extern EventLog eventLog;
+
+    #define EVENT_LOG(dev, channel, on, ms) eventLog.record(dev, channel, on, ms)
+#else
+    #define EVENT_LOG(dev, channel, on, ms)
+#endif // USE_EVENT_LOG
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,173 @@
+#include "history.h"
+
+#ifdef USE_HISTORY
+
+void HistoryAggregate::add(int16_t value) {
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+    sum += value;
+    count++;
+}
+
+int16_t HistoryAggregate::mean() {
+    if (count == 0) return HISTORY_NO_VALUE;
+    // rounded half away from zero
+    int32_t half = sum < 0 ? -static_cast<int32_t>(count / 2) : count / 2;
+    return (sum + half) / static_cast<int32_t>(count);
+}
+
+History::History(Device *_device, uint16_t _interval, const uint16_t *lengths, uint8_t windowCount, int8_t _exponent) :
+    device(_device),
+    interval(_interval > 0 ? _interval : 1),
+    exponent(_exponent)
+{
+    for (uint8_t i = 0; i < windowCount && i < HISTORY_WINDOWS; i++) {
+        windows[i].length = lengths[i] < interval ? interval : lengths[i];
+    }
+}
+
+// built on first use, the device may not have its name yet at construction
+const char* History::getName() {
+    if (name[0] == '\0') {
+        snprintf(name, sizeof(name), "%s_hist", device->getName());
+    }
+    return name;
+}
+
+// channel 0 of the device at the exponent of the history
+bool History::sample(int16_t &value) {
+    int32_t m;
+    if (!device->getFixed(0, exponent, m)) return false;
+    value = constrain(m, -32767L, 32767L); // HISTORY_NO_VALUE stays reserved
+    return true;
+}
+
+// close the window once its length is over, a gap without samples leaves it empty
+void History::roll(HistoryWindow &w) {
+    uint16_t elapsed = clock - w.start;
+    if (elapsed < w.length) return;
+
+    w.last = elapsed < 2 * static_cast<uint32_t>(w.length) ? w.current : HistoryAggregate();
+    w.current = HistoryAggregate();
+    w.start += elapsed - elapsed % w.length;
+}
+
+bool History::spin() {
+    unsigned long now = millis();
+    if (now - ts <= interval * 1000UL) return false;
+    ts = now;
+    clock += interval;
+
+    for (uint8_t i = 0; i < HISTORY_WINDOWS; i++) {
+        if (windows[i].length > 0) roll(windows[i]);
+    }
+
+    int16_t value;
+    if (!sample(value)) return false;
+
+    samples[head].t = clock;
+    samples[head].value = value;
+    head = (head + 1) % HISTORY_SIZE;
+    if (count < HISTORY_SIZE) count++;
+
+    for (uint8_t i = 0; i < HISTORY_WINDOWS; i++) {
+        if (windows[i].length > 0) windows[i].current.add(value);
+    }
+    return true;
+}
+
+void History::writeValue(Print &out, int16_t value) {
+    char buf[12];
+    FixedValue x = {value, exponent};
+    fixedFormat(buf, sizeof(buf), x, exponent < 0 ? -exponent : 0);
+    out.print(F("\""));
+    out.print(buf);
+    out.print(F("\""));
+}
+
+void History::writeAggregate(Print &out, HistoryAggregate &a) {
+    out.print(F("{\"n\": "));
+    out.print(a.count);
+    if (a.count > 0) {
+        out.print(F(", \"min\": "));
+        writeValue(out, a.min);
+        out.print(F(", \"max\": "));
+        writeValue(out, a.max);
+        out.print(F(", \"mean\": "));
+        writeValue(out, a.mean());
+    }
+    out.print(F("}"));
+}
+
+void History::writeJson(Print &out) {
+    out.print(F("{\"interval\": "));
+    out.print(interval);
+    out.print(F(", \"samples\": ["));
+    for (uint8_t i = 0; i < count; i++) {
+        const HistorySample &s = samples[(head + HISTORY_SIZE - count + i) % HISTORY_SIZE];
+        if (i > 0) out.print(F(", "));
+        out.print(F("["));
+        out.print(static_cast<uint16_t>(clock - s.t));
+        out.print(F(", "));
+        writeValue(out, s.value);
+        out.print(F("]"));
+    }
+    out.print(F("], \"windows\": ["));
+    for (uint8_t i = 0; i < HISTORY_WINDOWS && windows[i].length > 0; i++) {
+        if (i > 0) out.print(F(", "));
+        out.print(F("{\"length\": "));
+        out.print(windows[i].length);
+        out.print(F(", \"last\": "));
+        writeAggregate(out, windows[i].last);
+        out.print(F(", \"current\": "));
+        writeAggregate(out, windows[i].current);
+        out.print(F("}"));
+    }
+    out.print(F("]}"));
+}
+
+uint16_t History::readRegister(uint8_t field) {
+    if (field == 0) return count;
+    if (field == 1) {
+        return count > 0 ? samples[(head + HISTORY_SIZE - 1) % HISTORY_SIZE].value : HISTORY_NO_VALUE;
+    }
+
+    HistoryAggregate &a = windows[(field - 2) / 4].last;
+    switch ((field - 2) % 4) {
+        case 0: return a.min;
+        case 1: return a.max;
+        case 2: return a.mean();
+        default: return a.count;
+    }
+}
+
+History* findHistory(History **histories, const char *name) {
+    for (History **h = histories; *h != nullptr; ++h) {
+        if (strncmp((*h)->getDevice()->getName(), name, MAX_NAME_SIZE) == 0) return *h;
+    }
+    return nullptr;
+}
+
+bool readHistoryRegisters(History **histories, unsigned int offset, unsigned int quantity, unsigned char *out) {
+    for (unsigned int i = 0; i < quantity; i++) {
+        unsigned int slot = (offset + i) / HISTORY_REGS_PER_DEVICE;
+        unsigned int field = (offset + i) % HISTORY_REGS_PER_DEVICE;
+
+        // walk the list, it holds a handful of devices
+        History *h = nullptr;
+        for (unsigned int n = 0; histories[n] != nullptr; n++) {
+            if (n == slot) {
+                h = histories[n];
+                break;
+            }
+        }
+        if (h == nullptr) return false;
+
+        uint16_t value = h->readRegister(field);
+        out[i * 2] = value >> 8;
+        out[i * 2 + 1] = value & 0xFF;
+    }
+    return true;
+}
+
+#endif // USE_HISTORY
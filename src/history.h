@@ -0,0 +1,90 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "task.h"
+#include "device/device.h"
+
+#ifdef USE_HISTORY
+
+#define HISTORY_SIZE 24             // samples kept per device
+#define HISTORY_WINDOWS 2           // aggregate windows per device
+#define HISTORY_NO_VALUE (-32768)   // empty aggregate or no sample, also sent as 0x8000 in registers
+#define HISTORY_REGS_PER_DEVICE (2 + 4 * HISTORY_WINDOWS) // Modbus input registers per device
+#define HISTORY_MODBUS_ADDRESS 2000 // First Modbus input register of the history block
+
+struct HistorySample {
+    uint16_t t;     // s on the history clock, wraps after 18 h
+    int16_t value;  // mantissa at the exponent of the history
+};
+
+// min/max/mean of one window, updated with every sample
+struct HistoryAggregate {
+    int16_t min = HISTORY_NO_VALUE;
+    int16_t max = HISTORY_NO_VALUE;
+    int32_t sum = 0;    // cannot overflow, at most 65535 samples of |value| <= 32767
+    uint16_t count = 0;
+
+    void add(int16_t value);
+    int16_t mean();
+};
+
+// Tumbling window, the running aggregate is closed every length seconds
+struct HistoryWindow {
+    uint16_t length = 0;    // s, 0 if unused
+    uint16_t start = 0;     // s on the history clock where current began
+    HistoryAggregate current;
+    HistoryAggregate last;  // the last complete window
+};
+
+// Samples channel 0 of a device every interval seconds into a ring and
+// keeps min/max/mean per window while sampling, so no query ever walks
+// the ring for them. Values are stored as int16 at a fixed decimal
+// exponent, e.g. -2 keeps a temperature in 1/100 C, and saturate.
+class History : public Task {
+    private:
+        Device *device;
+        uint16_t interval;  // s between samples
+        int8_t exponent;
+
+        HistorySample samples[HISTORY_SIZE];
+        uint8_t head = 0;   // next slot to write
+        uint8_t count = 0;
+        HistoryWindow windows[HISTORY_WINDOWS];
+
+        uint16_t clock = 0; // s, advanced by interval with every sample
+        unsigned long ts = 0;
+        char name[MAX_NAME_SIZE] = ""; // "<device>_hist", cut to fit
+
+        bool sample(int16_t &value);
+        void roll(HistoryWindow &w);
+        void writeValue(Print &out, int16_t value);
+        void writeAggregate(Print &out, HistoryAggregate &a);
+    public:
+        // windowCount lengths in s, up to HISTORY_WINDOWS, each at least the interval
+        History(Device *_device, uint16_t _interval, const uint16_t *lengths, uint8_t windowCount, int8_t _exponent = -2);
+        bool spin() override;
+        unsigned long nextSpin() override { return remaining(ts, interval * 1000UL); }
+        const char* getName() override;
+        Device* getDevice() { return device; }
+
+        // {"interval": .., "samples": [[<age s>, "<value>"], ...],
+        //  "windows": [{"length": .., "last": {..}, "current": {..}}, ...]}
+        // samples oldest first, aged from the last sampling tick so both passes of a
+        // response print the same text, aggregates as {"n": .., "min": .., "max": .., "mean": ..}
+        void writeJson(Print &out);
+
+        // HISTORY_REGS_PER_DEVICE registers: samples held, latest sample, then
+        // min, max, mean, samples of the last complete window for each window
+        uint16_t readRegister(uint8_t field);
+};
+
+// null-terminated list lookups, used by the HTTP and Modbus servers
+History* findHistory(History **histories, const char *name);
+bool readHistoryRegisters(History **histories, unsigned int offset, unsigned int quantity, unsigned char *out);
+
+#endif // USE_HISTORY
+
+#endif // HISTORY_H
@@ -13,6 +13,66 @@ void setup() {
   delay(1000);
   diagLed.blink();
 
+  // Network first, then devices, the LED last
+#ifdef USE_HTTP
+  scheduler.add(&httpServer);
+#endif // USE_HTTP
+
+#ifdef USE_MODBUS
+  scheduler.add(&modbusServer);
+#endif // USE_MODBUS
+
+#ifdef USE_UDP
+  scheduler.add(&udpPublisher);
+#endif // USE_UDP
+
+#ifdef USE_MQTT
+  scheduler.add(&mqttClient);
+#endif // USE_MQTT
+
+  // the bank samples the port for in3 and in4, it is not in devices[]
+  inputBank.attach(&in3);
+  inputBank.attach(&in4);
+  scheduler.add(&inputBank);
+  scheduler.add(&bus1);
+  scheduler.add(&bus2);
+
+  for (Device** dev = devices; *dev != nullptr; ++dev) {
+    scheduler.add(*dev);
+  }
+
+#ifdef USE_RULES
+  // after the devices, a relay reacts in the same pass as its input
+  ruleEngine.load();
+  scheduler.add(&ruleEngine);
+#ifdef USE_HTTP
+  httpServer.attachRules(&ruleEngine);
+#endif // USE_HTTP
+#endif // USE_RULES
+
+#ifdef USE_HISTORY
+  for (History** h = histories; *h != nullptr; ++h) {
+    scheduler.add(*h);
+  }
+#ifdef USE_HTTP
+  httpServer.attachHistories(histories);
+#endif // USE_HTTP
+#ifdef USE_MODBUS
+  modbusServer.attachHistories(histories);
+#endif // USE_MODBUS
+#endif // USE_HISTORY
+
+  scheduler.add(&diagLed);
+
+#ifdef USE_PROFILER
+#ifdef USE_HTTP
+  httpServer.attachProfiler(scheduler.getProfiler());
+#endif // USE_HTTP
+#ifdef USE_MODBUS
+  modbusServer.attachProfiler(scheduler.getProfiler());
+#endif // USE_MODBUS
+#endif // USE_PROFILER
+
 #ifdef USE_SERIAL
   Serial.print("IP: ");
   Serial.println(Ethernet.localIP());
@@ -27,25 +87,14 @@ void setup() {
 
 void loop() {
 
-  bool busy = false;
-
-#ifdef USE_HTTP
-  busy |= httpServer.spin();
-#endif // USE_HTTP
-
-#ifdef USE_MODBUS
-  busy |= modbusServer.spin(); // Spin the Modbus server
-#endif
-
-  // Spin through all devices
-  for (Device** dev = devices; *dev != nullptr; ++dev) {
-    busy |= (*dev)->spin();
-  }
-
-  diagLed.spin();
+  // Run only the tasks which are due
+  bool busy = scheduler.spin();
 
   if (busy) {
     diagLed.blink();
+    scheduler.wake(&diagLed); // switch it off again when the blink is over
+  } else {
+    scheduler.idle();
   }
 
-}
\ No newline at end of file
+}
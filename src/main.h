@@ -18,12 +18,26 @@
 #include "net/modbusServer.h"
 #endif // USE_MODBUS
 
+#ifdef USE_UDP
+#include "net/udpPublisher.h"
+#endif // USE_UDP
+
+#ifdef USE_MQTT
+#include "net/mqtt.h"
+#endif // USE_MQTT
+
+#include "device/oneWireBus.h"
 #include "device/ds18b20.h"
 #include "device/diagLed.h"
 #include "device/binaryInput.h"
+#include "device/inputBank.h"
 #include "device/binaryOutput.h"
+#include "device/pulseMeter.h"
 
 #include "debugSerial.h"
+#include "history.h"
+#include "rules.h"
+#include "scheduler.h"
 
 // MAC address must be unique on your network
 byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
@@ -46,13 +60,30 @@ IPAddress ip(192, 168, 1, 177);
 
 #define DIAG_LED 3
 
-DS18B20 sensor1("sensor_1",SENSOR1_PIN);
-DS18B20 sensor2("sensor_2",SENSOR2_PIN);
-
-BinaryInput in1("input_1",IN1_PIN);
-BinaryInput in2("input_2",IN2_PIN);
-BinaryInput in3("input_3",IN3_PIN);
-BinaryInput in4("input_4",IN4_PIN);
+// 1-Wire buses, add a DS18B20 per sensor wired to a bus.
+// An optional third argument sets the resolution, 9..12 bits (94..750 ms per conversion),
+// an optional fourth the ROM code, needed when several sensors share a bus:
+//   const uint8_t sensor3Rom[8] = {0x28, ...};
+//   DS18B20 sensor3("sensor_3",&bus1,12,sensor3Rom);
+OneWireBus bus1(SENSOR1_PIN);
+OneWireBus bus2(SENSOR2_PIN);
+
+DS18B20 sensor1("sensor_1",&bus1);
+DS18B20 sensor2("sensor_2",&bus2);
+
+// Inputs 1 and 2 count pulses of S0 meters, edges are caught by interrupt
+BinaryInput in1("input_1",IN1_PIN,InputMode::INTERRUPT);
+BinaryInput in2("input_2",IN2_PIN,InputMode::INTERRUPT);
+// Inputs 3 and 4 share one port read and debounce per tick. They keep
+// their names everywhere, only Modbus reads them as the bank channels.
+BinaryInput in3("input_3",IN3_PIN,InputMode::BANKED);
+BinaryInput in4("input_4",IN4_PIN,InputMode::BANKED);
+InputBank inputBank("inputs");
+
+PulseMeter in1Count("input_1_count",&in1,PulseQuantity::COUNT);
+PulseMeter in2Count("input_2_count",&in2,PulseQuantity::COUNT);
+PulseMeter in1Freq("input_1_freq",&in1,PulseQuantity::FREQUENCY);
+PulseMeter in2Freq("input_2_freq",&in2,PulseQuantity::FREQUENCY);
 
 // Initialize the relay outputs
 BinaryOutput relay1("relay_1",RELAY1_PIN);
@@ -70,9 +101,33 @@ Device* devices[] = {
     &in2,
     &in3,
     &in4,
+    &in1Count,
+    &in2Count,
+    &in1Freq,
+    &in2Freq,
     nullptr // Null-terminated list
 };
 
+#ifdef USE_HISTORY
+// Temperatures every 10 s at 1/100 C, min/max/mean per minute and per hour
+const uint16_t sensorWindows[] = {60, 3600};
+History sensor1History(&sensor1, 10, sensorWindows, 2);
+History sensor2History(&sensor2, 10, sensorWindows, 2);
+
+// Devices with a history, served in this order from Modbus input register 2000
+History* histories[] = {
+    &sensor1History,
+    &sensor2History,
+    nullptr // Null-terminated list
+};
+#endif // USE_HISTORY
+
+#ifdef USE_RULES
+// Reactions of the relays to inputs and temperatures, rules address
+// devices by their index in the list above
+RuleEngine ruleEngine(devices);
+#endif // USE_RULES
+
 #ifdef USE_HTTP
 // Initialize the Ethernet server
 Http httpServer(devices);
@@ -80,22 +135,77 @@ Http httpServer(devices);
 
 #ifdef USE_MODBUS
 ModbusNode modbusNodes[] = {
-    ModbusNode{&sensor1, setValueType::FLOAT, 0, 1,10}, // Sensor 1
-    ModbusNode{&sensor2, setValueType::FLOAT, 1, 1,10}, // Sensor 2
+    // Scaled integers, a power of ten multiplier takes the integer path,
+    // FLOAT32 would pull soft-float into every image refresh
+    ModbusNode{&sensor1, setValueType::FIXED, 0, ModbusEncoding::INT32, 100.0}, // Sensor 1 in 1/100 C, registers 0-1
+    ModbusNode{&sensor2, setValueType::FIXED, 2, ModbusEncoding::INT32, 100.0}, // Sensor 2 in 1/100 C, registers 2-3
+    ModbusNode{&in1Count, setValueType::UINT32, 4, ModbusEncoding::UINT32}, // Input 1 pulses, registers 4-5
+    ModbusNode{&in2Count, setValueType::UINT32, 6, ModbusEncoding::UINT32}, // Input 2 pulses, registers 6-7
+    ModbusNode{&in1Freq, setValueType::FIXED, 8, ModbusEncoding::INT32, 1000.0}, // Input 1 pulses per 1000 s, registers 8-9
+    ModbusNode{&in2Freq, setValueType::FIXED, 10, ModbusEncoding::INT32, 1000.0}, // Input 2 pulses per 1000 s, registers 10-11
     ModbusNode{&relay1, setValueType::BOOL, 0}, // Relay 1
     ModbusNode{&relay2, setValueType::BOOL, 1}, // Relay 2
     ModbusNode{&relay3, setValueType::BOOL, 2}, // Relay 3
     ModbusNode{&in1, setValueType::BOOL, 3}, // Input 1
     ModbusNode{&in2, setValueType::BOOL, 4}, // Input 2
-    ModbusNode{&in3, setValueType::BOOL, 5}, // Input 3
-    ModbusNode{&in4, setValueType::BOOL, 6}, // Input 4
+    ModbusNode{&inputBank, setValueType::BOOL, 5, 1, 1.0, 0}, // Input 3, bank channel 0
+    ModbusNode{&inputBank, setValueType::BOOL, 6, 1, 1.0, 1}, // Input 4, bank channel 1
     {} // sentinel node
 };
 // Initialize the Modbus server
 ModbusServer modbusServer(modbusNodes);
 #endif // USE_MODBUS
 
+#ifdef USE_UDP
+// Receivers of change notifications, unicast hosts and/or one multicast group
+IPAddress udpSubscribers[] = {
+    IPAddress(192, 168, 1, 10),
+    IPAddress(239, 1, 2, 3),
+};
+UdpPublisher udpPublisher(devices, udpSubscribers, sizeof(udpSubscribers) / sizeof(udpSubscribers[0]));
+#endif // USE_UDP
+
+#ifdef USE_MQTT
+// MQTT broker, devices are published to godbus/<name>
+IPAddress mqttBroker(192, 168, 1, 2);
+Mqtt mqttClient(devices, mqttBroker);
+#endif // USE_MQTT
+
 // Initialize the diagnostic LED
 DiagLed diagLed(DIAG_LED);
 
+// Spins every component when its deadline is due
+Scheduler scheduler;
+
+#ifdef __AVR__
+// the sizes only mean something on the target, see RAM_BUDGET_BUFFERS
+static_assert(sizeof(scheduler)
+#ifdef USE_HTTP
+    + sizeof(httpServer)
+#endif // USE_HTTP
+#ifdef USE_MODBUS
+    + sizeof(modbusServer) + MODBUS_ADU_SIZE * MODBUS_PIPELINE_DEPTH
+#endif // USE_MODBUS
+#ifdef USE_UDP
+    + sizeof(udpPublisher)
+#endif // USE_UDP
+#ifdef USE_MQTT
+    + sizeof(mqttClient)
+#endif // USE_MQTT
+#ifdef USE_HISTORY
+    + sizeof(History) * (sizeof(histories) / sizeof(histories[0]) - 1)
+#endif // USE_HISTORY
+#ifdef USE_EVENT_LOG
+    + sizeof(eventLog)
+#endif // USE_EVENT_LOG
+#ifdef USE_RULES
+    + sizeof(ruleEngine)
+#endif // USE_RULES
+#ifdef USE_METRICS
+    + sizeof(metrics)
+#endif // USE_METRICS
+    <= RAM_BUDGET_BUFFERS,
+    "Static buffers over RAM_BUDGET_BUFFERS, lower the socket counts or MODBUS_PIPELINE_DEPTH or drop a feature in config.h");
+#endif // __AVR__
+
 #endif // MAIN_H
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "metrics.h"
+
+#ifdef USE_METRICS
+
+Metrics metrics = {};
+
+// function codes in the order of Metrics::modbusRequests, last slot is other
+static const unsigned char modbusFunctions[METRICS_MODBUS_FUNCTIONS - 1] PROGMEM = {
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x0F, 0x10, 0x18
+};
+
+// status codes in the order of Metrics::httpRequests, last slot is other
+static const int httpStatuses[METRICS_HTTP_STATUSES - 1] PROGMEM = {
+    200, 400, 404, 414, 500
+};
+
+unsigned char Metrics::modbusFunctionSlot(unsigned char functionCode) {
+    for (unsigned char i = 0; i < METRICS_MODBUS_FUNCTIONS - 1; i++) {
+        if (pgm_read_byte(&modbusFunctions[i]) == functionCode) return i;
+    }
+    return METRICS_MODBUS_FUNCTIONS - 1;
+}
+
+unsigned char Metrics::httpStatusSlot(int statuscode) {
+    for (unsigned char i = 0; i < METRICS_HTTP_STATUSES - 1; i++) {
+        if (static_cast<int>(pgm_read_word(&httpStatuses[i])) == statuscode) return i;
+    }
+    return METRICS_HTTP_STATUSES - 1;
+}
+
+static void writeType(Print &out, const __FlashStringHelper *name) {
+    out.print(F("# TYPE "));
+    out.print(name);
+    out.print(F(" counter\n"));
+}
+
+static void writeSample(Print &out, const __FlashStringHelper *name, uint32_t value) {
+    out.print(name);
+    out.print(F(" "));
+    out.print(value);
+    out.print(F("\n"));
+}
+
+static void writeCounter(Print &out, const __FlashStringHelper *name, uint32_t value) {
+    writeType(out, name);
+    writeSample(out, name, value);
+}
+
+// one family of per device counters, devices without it are skipped
+static void writeDeviceCounter(Print &out, Device** devices,
+                               const __FlashStringHelper *name, DeviceCounter counter) {
+    bool typed = false;
+    uint32_t value;
+
+    for (Device** dev = devices; *dev != nullptr; ++dev) {
+        if (!(*dev)->getCounter(counter, value)) continue;
+
+        if (!typed) {
+            writeType(out, name);
+            typed = true;
+        }
+        out.print(name);
+        out.print(F("{device=\""));
+        out.print((*dev)->getName());
+        out.print(F("\"} "));
+        out.print(value);
+        out.print(F("\n"));
+    }
+}
+
+void Metrics::writeText(Print &out, Device** devices) {
+    writeType(out, F("godbus_modbus_requests_total"));
+    for (unsigned char i = 0; i < METRICS_MODBUS_FUNCTIONS; i++) {
+        out.print(F("godbus_modbus_requests_total{function=\""));
+        if (i < METRICS_MODBUS_FUNCTIONS - 1) {
+            out.print(pgm_read_byte(&modbusFunctions[i]));
+        } else {
+            out.print(F("other"));
+        }
+        out.print(F("\"} "));
+        out.print(modbusRequests[i]);
+        out.print(F("\n"));
+    }
+
+    writeType(out, F("godbus_modbus_exceptions_total"));
+    for (unsigned char i = 1; i < METRICS_MODBUS_EXCEPTIONS; i++) {
+        if (i == 0x07 || i == 0x09) continue; // not defined by Modbus
+        out.print(F("godbus_modbus_exceptions_total{code=\""));
+        out.print(i);
+        out.print(F("\"} "));
+        out.print(modbusExceptions[i]);
+        out.print(F("\n"));
+    }
+
+    writeCounter(out, F("godbus_modbus_received_bytes_total"), modbusBytesIn);
+    writeCounter(out, F("godbus_modbus_sent_bytes_total"), modbusBytesOut);
+    writeCounter(out, F("godbus_modbus_connections_accepted_total"), modbusAccepted);
+    writeCounter(out, F("godbus_modbus_connections_rejected_total"), modbusRejected);
+
+    writeType(out, F("godbus_http_requests_total"));
+    for (unsigned char i = 0; i < METRICS_HTTP_STATUSES; i++) {
+        out.print(F("godbus_http_requests_total{status=\""));
+        if (i < METRICS_HTTP_STATUSES - 1) {
+            out.print(static_cast<int>(pgm_read_word(&httpStatuses[i])));
+        } else {
+            out.print(F("other"));
+        }
+        out.print(F("\"} "));
+        out.print(httpRequests[i]);
+        out.print(F("\n"));
+    }
+
+    writeCounter(out, F("godbus_http_received_bytes_total"), httpBytesIn);
+    writeCounter(out, F("godbus_http_sent_bytes_total"), httpBytesOut);
+
+    writeDeviceCounter(out, devices, F("godbus_input_edges_total"), DeviceCounter::INPUT_EDGES);
+    writeDeviceCounter(out, devices, F("godbus_sensor_errors_total"), DeviceCounter::SENSOR_ERRORS);
+    writeDeviceCounter(out, devices, F("godbus_sensor_reconnects_total"), DeviceCounter::SENSOR_RECONNECTS);
+}
+
+#endif // USE_METRICS
@@ -0,0 +1,43 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "config.h"
+#include <Arduino.h>
+
+#ifdef USE_METRICS
+
+#include "device/device.h"
+
+#define METRICS_MODBUS_FUNCTIONS 10 // served function codes + other
+#define METRICS_MODBUS_EXCEPTIONS 12 // indexed by exception code
+#define METRICS_HTTP_STATUSES 6     // known status codes + other
+
+// Protocol counters, incremented through the METRIC_ macros below
+struct Metrics {
+    uint32_t modbusRequests[METRICS_MODBUS_FUNCTIONS];
+    uint32_t modbusExceptions[METRICS_MODBUS_EXCEPTIONS];
+    uint32_t modbusBytesIn;
+    uint32_t modbusBytesOut;
+    uint32_t modbusAccepted;
+    uint32_t modbusRejected;
+    uint32_t httpRequests[METRICS_HTTP_STATUSES];
+    uint32_t httpBytesIn;
+    uint32_t httpBytesOut;
+
+    static unsigned char modbusFunctionSlot(unsigned char functionCode);
+    static unsigned char httpStatusSlot(int statuscode);
+
+    // Prometheus text exposition format, names are streamed from flash
+    void writeText(Print &out, Device** devices);
+};
+
+extern Metrics metrics;
+
+    #define METRIC_INC(x) (metrics.x++)
+    #define METRIC_ADD(x, n) (metrics.x += (n))
+#else
+    #define METRIC_INC(x)
+    #define METRIC_ADD(x, n)
+#endif // USE_METRICS
+
+#endif // METRICS_H
@@ -0,0 +1,100 @@
+#include "deviceJson.h"
+
+// generic text of a channel value, single channel devices use serialize().
+// False when the type has no text, the value is then written as null.
+static bool formatValue(char *s, size_t len, const setValue &value, setValueType type) {
+    switch (type) {
+        case setValueType::BOOL:
+            snprintf(s, len, "%c", value.b ? '1' : '0');
+            break;
+        case setValueType::INT:
+            snprintf(s, len, "%d", value.i);
+            break;
+        case setValueType::UINT32:
+            snprintf(s, len, "%lu", static_cast<unsigned long>(value.u));
+            break;
+        case setValueType::FIXED:
+            fixedFormat(s, len, value.x, value.x.exponent < 0 ? -value.x.exponent : 0);
+            break;
+        default:
+            // no device serves floats, dtostrf would link the float printer
+            return false;
+    }
+    return true;
+}
+
+// a value as a JSON string, or an unquoted null
+static void writeValue(Print &out, const char *data, bool valid) {
+    if (!valid) {
+        out.print(F("null"));
+        return;
+    }
+    out.print(F("\""));
+    out.print(data);
+    out.print(F("\""));
+}
+
+// all channels of a device, fetched a block at a time
+static void writeChannels(Print &out, Device *dev) {
+    setValue values[JSON_BATCH_SIZE];
+    char data[MAX_DEV_DATA_LEN];
+    uint8_t channels = dev->getChannelCount();
+    bool valid = dev->hasValue();
+    uint8_t written = 0;
+
+    out.print(F("["));
+    while (written < channels) {
+        uint8_t wanted = channels - written < JSON_BATCH_SIZE ? channels - written : JSON_BATCH_SIZE;
+        uint8_t count = dev->getMany(written, wanted, values);
+
+        for (uint8_t k = 0; k < count; k++) {
+            if (written > 0) out.print(F(", "));
+            bool known = valid && formatValue(data, MAX_DEV_DATA_LEN, values[k], dev->getChannelType(written));
+            writeValue(out, data, known);
+            written++;
+        }
+        // a device serving fewer channels than it counts ends the array early
+        if (count < wanted) break;
+    }
+    out.print(F("]"));
+}
+
+void writeDevicesJson(Print &out, Device** devices, unsigned long changedSince) {
+    bool first = true;
+
+    for (Device** dev = devices; *dev != nullptr; ++dev) {
+        // since 0 means full state, also for devices which never changed
+        if (changedSince != 0 && (*dev)->getVersion() <= changedSince) {
+            continue;
+        }
+
+        if (!first) {
+            out.print(F(", "));
+        }
+        first = false;
+
+        out.print(F("\""));
+        out.print((*dev)->getName());
+        out.print(F("\": "));
+
+        if ((*dev)->getChannelCount() > 1) {
+            writeChannels(out, *dev);
+            continue;
+        }
+
+        // Serialize the device and add it to the response, without a reading it is null
+        char deviceData[MAX_DEV_DATA_LEN];
+        bool valid = (*dev)->hasValue();
+        if (valid) (*dev)->serialize(deviceData,MAX_DEV_DATA_LEN);
+        writeValue(out, deviceData, valid);
+    }
+}
+
+void writeChangesJson(Print &out, Device** devices, unsigned long changedSince) {
+    // Current sequence first, the client passes it as since= next time
+    out.print(F("{\"seq\": "));
+    out.print(Device::getSequence());
+    out.print(F(", \"devices\": {"));
+    writeDevicesJson(out, devices, changedSince);
+    out.print(F("}}"));
+}
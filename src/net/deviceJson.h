@@ -0,0 +1,20 @@
+#ifndef DEVICE_JSON_H
+#define DEVICE_JSON_H
+
+#include <Arduino.h>
+
+#include "device/device.h"
+
+#define MAX_DEV_DATA_LEN 16
+#define JSON_BATCH_SIZE 8   // Channels of a multi channel device fetched per getMany() call
+
+// Stream "name": "value" pairs of devices changed after changedSince,
+// all devices if changedSince is 0. Multi channel devices are written as
+// "name": ["value", ...]
+void writeDevicesJson(Print &out, Device** devices, unsigned long changedSince);
+
+// Stream {"seq": <current sequence>, "devices": {...}} with the devices
+// changed after changedSince
+void writeChangesJson(Print &out, Device** devices, unsigned long changedSince);
+
+#endif // DEVICE_JSON_H
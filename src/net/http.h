@@ -4,39 +4,52 @@
 #include <Arduino.h>
 #include <Ethernet.h>
 
+#include "config.h"
+#include "task.h"
+#include "debugSerial.h"
 #include "device/device.h"
+#include "httpClient.h"
 
-#define MAX_DEV_DATA_LEN 16
-#define MAX_REQUEST_SIZE 64
-#define MAX_RESPONSE_SIZE 256
-
-enum class HttpState {
-    NOT_STARTED,
-    LISTEN,
-    RECV_REQUEST,
-    FLUSHING,
-    SENDING_RESPONSE,
-};
-
-class Http {
+class Http : public Task {
 private:
     EthernetServer server;
     Device** devices = nullptr; // Array to hold device pointers, adjust size as needed
-    EthernetClient client;
-    HttpState state = HttpState::NOT_STARTED;
-    int statuscode = 200; // Default status code
-    char request[MAX_REQUEST_SIZE];
-    unsigned char rqLen = 0;
-    char response[MAX_RESPONSE_SIZE]; // Buffer for the response;
-    void processRequest();
-    void prepareResponse();
+    HttpClient socket[HTTP_SOCKETS];
+
+    bool started = false;
+
+#ifdef USE_PROFILER
+    Profiler *profiler = nullptr;
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    History **histories = nullptr;
+#endif // USE_HISTORY
+#ifdef USE_RULES
+    RuleEngine *rules = nullptr;
+#endif // USE_RULES
+
 public:
     Http(Device** _devices) :
         server(80),  // Initialize the Ethernet server on port 80
         devices(_devices)
     {}
 
-    bool spin();
+    bool spin() override;
+    unsigned long nextSpin() override { return TASK_POLL_INTERVAL; }
+    const char* getName() override { return "http"; }
+
+#ifdef USE_PROFILER
+    // Serve the profiler statistics at GET /profile
+    void attachProfiler(Profiler *_profiler) { profiler = _profiler; }
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    // Serve GET /<name>/history, null-terminated list
+    void attachHistories(History **_histories) { histories = _histories; }
+#endif // USE_HISTORY
+#ifdef USE_RULES
+    // Serve GET /rules and /rules/<slot>/<hex>
+    void attachRules(RuleEngine *_rules) { rules = _rules; }
+#endif // USE_RULES
 };
 
-#endif  // HTTP_H
\ No newline at end of file
+#endif  // HTTP_H
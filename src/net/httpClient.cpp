@@ -0,0 +1,353 @@
+#include "httpClient.h"
+
+bool HttpClient::isAssignedToMe(EthernetClient &c) {
+    return (client.getSocketNumber() == c.getSocketNumber());
+}
+
+bool HttpClient::tryAssignNewConnection(const EthernetClient &c) {
+    if (state != HttpState::LISTEN)
+        return false;
+    client = c;
+    requestCount = 0;
+    startRequest();
+    return true;
+}
+
+void HttpClient::startRequest() {
+    rqLen = 0;
+    hdrLen = 0;
+    statuscode = 200;
+    keepAlive = false;
+    ts = millis();
+    state = HttpState::RECV_REQUEST;
+}
+
+void HttpClient::closeConnection() {
+    client.stop();
+    state = HttpState::LISTEN;
+}
+
+bool HttpClient::spin() {
+    bool busy = false;
+
+    //if not initialized
+    if (devices == nullptr) return false;
+
+    switch(state) {
+        case HttpState::NOT_STARTED:
+            //Dummy state, go to listen
+            state = HttpState::LISTEN;
+            break;
+
+        case HttpState::LISTEN:
+            //nothing to do here, we are waiting for assigning a new connection
+            break;
+
+        case HttpState::RECV_REQUEST:
+        case HttpState::RECV_HEADERS:
+            if (!client.connected()) {
+                closeConnection();
+                break;
+            }
+
+            busy = receiveRequest();
+
+            if (state != HttpState::SENDING_RESPONSE) {
+                // drop idle keep-alive connections and stalled requests
+                if (millis() - ts > HTTP_IDLE_TIMEOUT) {
+                    closeConnection();
+                    busy = true;
+                }
+                break;
+            }
+            // request complete, answer it in the same pass
+            // fall through
+
+        case HttpState::SENDING_RESPONSE:
+            busy = true;
+            // Prepare the response
+            processRequest();
+
+            // Errors and the last allowed request close the connection
+            requestCount++;
+            if (statuscode != 200 || requestCount >= HTTP_MAX_REQUESTS) {
+                keepAlive = false;
+            }
+            
+            // Stream the response straight to the socket
+            sendResponse();
+
+            if (keepAlive) {
+                // Pipelined requests are already waiting in the socket
+                startRequest();
+            } else {
+                // Close the connection
+                closeConnection();
+            }
+            break;
+            
+    }
+    return busy;
+}
+
+bool HttpClient::receiveRequest() {
+    bool busy = false;
+
+    while (client.available()) {
+        busy = true;
+        ts = millis();
+        char c = client.read();
+        METRIC_INC(httpBytesIn);
+
+        if (c == '\r') continue; // lines end with CRLF, only LF is significant
+
+        if (state == HttpState::RECV_REQUEST) {
+            if (c == '\n') {
+                if (rqLen == 0) continue; // tolerate empty lines between requests
+                request[rqLen] = '\0';
+
+                // HTTP/1.1 keeps the connection open unless told otherwise
+                keepAlive = strstr(request, " HTTP/1.1") != nullptr;
+                state = HttpState::RECV_HEADERS;
+            } else if (rqLen < MAX_REQUEST_SIZE - 1) {
+                request[rqLen++] = c;
+            } else {
+                statuscode = 414; //URL too long, skip the rest of the line
+            }
+        } else {
+            if (c == '\n') {
+                if (hdrLen == 0) {
+                    // empty line, end of request
+                    state = HttpState::SENDING_RESPONSE;
+                    break;
+                }
+                header[hdrLen] = '\0';
+                processHeader();
+                hdrLen = 0;
+            } else if (hdrLen < MAX_HEADER_SIZE - 1) {
+                header[hdrLen++] = c;
+            }
+        }
+    }
+    return busy;
+}
+
+void HttpClient::processHeader() {
+    // Connection is the only header we care about
+    if (strncasecmp(header, "connection:", 11) != 0) return;
+
+    char *value = &header[11];
+    while (*value == ' ') value++;
+
+    if (strncasecmp(value, "close", 5) == 0) {
+        keepAlive = false;
+    } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+        keepAlive = true;
+    }
+}
+
+void HttpClient::processRequest() {
+    // Process the request here
+    body = HttpBody::EMPTY;
+
+    if (statuscode != 200) {
+        //there was an error during receiving request eg, request too long
+        return;
+    }
+
+    if (strncmp(request,"GET ",4) != 0) {
+        statuscode = 400;   // Bad request
+        return;
+    }
+
+    char *url = &request[4];
+
+    for (int i = 0; i < (MAX_REQUEST_SIZE-4); i++ ) {
+        if (url[i] == ' ' || url[i] == '\r' || url[i] == '\n' || url[i] == '\0') {
+            url[i] = '\0';
+        }
+    }
+    
+    // Check if the URL is valid and process it
+    if (strncmp(url,"/",1) == 0 && strlen(url) == 1) {
+        // Respond with all devices
+        body = HttpBody::DEVICES;
+        return;
+#ifdef USE_PROFILER
+    } else if (strcmp(url,"/profile") == 0 && profiler != nullptr) {
+        body = HttpBody::PROFILE;
+        return;
+#endif // USE_PROFILER
+#ifdef USE_METRICS
+    } else if (strcmp(url,"/metrics") == 0) {
+        body = HttpBody::METRICS;
+        return;
+#endif // USE_METRICS
+#ifdef USE_RULES
+    } else if (strcmp(url,"/rules") == 0 && rules != nullptr) {
+        body = HttpBody::RULES;
+        return;
+    } else if (strncmp(url,"/rules/",7) == 0 && rules != nullptr) {
+        // Replace a rule, /rules/<slot>/<hex>
+        char *end = nullptr;
+        unsigned long slot = strtoul(&url[7], &end, 10);
+        if (end == &url[7] || *end != '/' || slot >= RULE_MAX_RULES || !rules->set(slot, end + 1)) {
+            statuscode = 400;   // Bad request
+            return;
+        }
+        body = HttpBody::STATUS_OK;
+        return;
+#endif // USE_RULES
+    } else if (strncmp(url,"/?since=",8) == 0) {
+        // Respond with devices changed after the given sequence number
+        char *end = nullptr;
+        since = strtoul(&url[8], &end, 10);
+        if (end == &url[8] || *end != '\0') {
+            statuscode = 400;   // Bad request
+            return;
+        }
+        body = HttpBody::CHANGES;
+        return;
+    } else if (strncmp(url,"/",1) == 0) {
+        char *deviceId = &url[1];
+        char *state = nullptr;
+
+        for (int i = 1; url[i] != '\0'; i++) {
+            if (url[i] == '/') {
+                url[i] = '\0';
+                state = &url[i+1];
+                break;
+            } else if (url[i] == ' ' || url[i] == ' ' || url[i] == '\r' || url[i] == '\n') {
+                break;
+            }
+        }
+
+        if (state == nullptr) {
+            // Serial.println("state not found");
+            statuscode = 400;  //Bad request
+            return;
+        }
+
+#ifdef USE_HISTORY
+        if (strcmp(state, "history") == 0 && histories != nullptr) {
+            history = findHistory(histories, deviceId);
+            if (history != nullptr) {
+                body = HttpBody::HISTORY;
+            } else {
+                statuscode = 404; // Not Found
+            }
+            return;
+        }
+#endif // USE_HISTORY
+
+        // Find the device by ID
+        for (Device** dev = devices; *dev != nullptr; ++dev) {
+            if (strncmp((*dev)->getName(), deviceId, MAX_NAME_SIZE) == 0) {
+                // Device found, set the state
+
+                //TODO convert deserialize to const char
+                setterOutput result = (*dev)->deserialize(state,MAX_DEV_DATA_LEN);
+
+                if (result == setterOutput::OK) {
+                    body = HttpBody::STATUS_OK;
+                    statuscode = 200; // OK
+                } else {
+                    statuscode = 500; // Internal Server Error
+                }
+                return;
+            }
+        }
+        // Device not found
+        statuscode = 404; // Not Found
+    }
+}
+
+void HttpClient::sendResponse() {
+    // Dry run to learn the body length, devices are not spun in between
+    // so both passes serialize the same values
+    ByteCounter counter;
+    writeBody(counter);
+
+    TxBuffer out(client);
+
+    out.print(F("HTTP/1.1 "));
+    out.print(statuscode);
+    out.print(F(" "));
+    
+    if (statuscode == 200) {
+        out.print(F("OK"));
+    } else if (statuscode == 400) {
+        out.print(F("Bad Request"));
+    } else if (statuscode == 404) {
+        out.print(F("Not Found"));
+    } else if (statuscode == 414) {
+        out.print(F("URI Too Long"));
+    } else if (statuscode == 500) {
+        out.print(F("Internal Server Error"));
+    } else {
+        out.print(F("Unknown Status"));
+    }
+    if (body == HttpBody::METRICS) {
+        out.print(F("\r\nContent-Type: text/plain; version=0.0.4"));
+    } else {
+        out.print(F("\r\nContent-Type: application/json"));
+    }
+    out.print(F("\r\nContent-Length: "));
+    out.print(static_cast<unsigned long>(counter.getCount()));
+    if (keepAlive) {
+        out.print(F("\r\nConnection: keep-alive\r\n\r\n"));
+    } else {
+        out.print(F("\r\nConnection: close\r\n\r\n"));
+    }
+
+    writeBody(out);
+    out.flush();
+
+    // counted after the response, so both passes above export the same values
+    METRIC_INC(httpRequests[Metrics::httpStatusSlot(statuscode)]);
+    METRIC_ADD(httpBytesOut, out.getTotal());
+}
+
+void HttpClient::writeBody(Print &out) {
+    switch (body) {
+        case HttpBody::DEVICES:
+            prepareResponse(out);
+            break;
+        case HttpBody::CHANGES:
+            writeChangesJson(out, devices, since);
+            break;
+#ifdef USE_PROFILER
+        case HttpBody::PROFILE:
+            profiler->writeJson(out);
+            break;
+#endif // USE_PROFILER
+#ifdef USE_METRICS
+        case HttpBody::METRICS:
+            metrics.writeText(out, devices);
+            break;
+#endif // USE_METRICS
+#ifdef USE_RULES
+        case HttpBody::RULES:
+            rules->writeJson(out);
+            break;
+#endif // USE_RULES
+#ifdef USE_HISTORY
+        case HttpBody::HISTORY:
+            history->writeJson(out);
+            break;
+#endif // USE_HISTORY
+        case HttpBody::STATUS_OK:
+            out.print(F("{\"status\": \"OK\"}"));
+            break;
+        default:
+            out.print(F("{}"));
+            break;
+    }
+}
+
+void HttpClient::prepareResponse(Print &out) {
+    // Stream the response with all devices, one device at a time
+    out.print(F("{"));
+    writeDevicesJson(out, devices, 0);
+    out.print(F("}"));
+}
@@ -0,0 +1,96 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+#include "device/device.h"
+#include "txStream.h"
+#include "deviceJson.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "history.h"
+#include "rules.h"
+
+#define MAX_REQUEST_SIZE 64
+#define MAX_HEADER_SIZE 24      // Enough for "Connection: keep-alive", longer headers are cut
+#define HTTP_IDLE_TIMEOUT 5000  // ms without traffic before a connection is closed
+#define HTTP_MAX_REQUESTS 100   // Requests served on one connection before it is closed
+
+enum class HttpState {
+    NOT_STARTED,
+    LISTEN,
+    RECV_REQUEST,   // request line
+    RECV_HEADERS,   // header lines until the empty line
+    SENDING_RESPONSE,
+};
+
+// Body sent with the response, streamed when the response is written
+enum class HttpBody {
+    EMPTY,      // {}
+    STATUS_OK,  // {"status": "OK"}
+    DEVICES,    // all devices
+    CHANGES,    // devices changed since a sequence number
+    PROFILE,    // loop profiler statistics
+    METRICS,    // counters in Prometheus text format
+    HISTORY,    // samples and aggregates of one device
+    RULES,      // rule table
+};
+
+class HttpClient {
+private:
+    Device** devices = nullptr; // Array to hold device pointers, adjust size as needed
+    EthernetClient client;
+    HttpState state = HttpState::NOT_STARTED;
+    int statuscode = 200; // Default status code
+    char request[MAX_REQUEST_SIZE];
+    unsigned char rqLen = 0;
+    char header[MAX_HEADER_SIZE];
+    unsigned char hdrLen = 0;
+    HttpBody body = HttpBody::EMPTY;
+    unsigned long since = 0; // Sequence number of a changes query
+
+    bool keepAlive = false; // Keep the connection open after the response
+    unsigned int requestCount = 0; // Requests served on this connection
+    unsigned long ts; // Last activity on the connection
+
+#ifdef USE_PROFILER
+    Profiler *profiler = nullptr;
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    History **histories = nullptr;
+    History *history = nullptr; // of a history query
+#endif // USE_HISTORY
+#ifdef USE_RULES
+    RuleEngine *rules = nullptr;
+#endif // USE_RULES
+
+    void startRequest();
+    bool receiveRequest();
+    void processHeader();
+    void closeConnection();
+    void processRequest();
+    void sendResponse();
+    void writeBody(Print &out);
+    void prepareResponse(Print &out);
+public:
+    HttpClient() {}
+    HttpClient(Device** _devices) :
+        devices(_devices)
+    {}
+
+    bool spin();
+    bool isAssignedToMe(EthernetClient &c);
+#ifdef USE_PROFILER
+    void setProfiler(Profiler *_profiler) { profiler = _profiler; }
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    void setHistories(History **_histories) { histories = _histories; }
+#endif // USE_HISTORY
+#ifdef USE_RULES
+    void setRules(RuleEngine *_rules) { rules = _rules; }
+#endif // USE_RULES
+    bool tryAssignNewConnection(const EthernetClient &c);
+};
+
+#endif  // HTTP_CLIENT_H
\ No newline at end of file
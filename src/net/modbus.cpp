@@ -1,9 +1,15 @@
 #include "modbus.h"
 
+unsigned char ModbusClient::sendbuf[MODBUS_ADU_SIZE * MODBUS_PIPELINE_DEPTH];
+
 bool ModbusClient::isAssignedToMe(EthernetClient &c) {
     return (client.getSocketNumber() == c.getSocketNumber());
 }
 
+bool ModbusClient::isActive() {
+    return state != ModbusState::NOT_STARTED && state != ModbusState::LISTEN;
+}
+
 bool ModbusClient::tryAssignNewConnection(const EthernetClient &c) {
     if (state != ModbusState::LISTEN)
         return false;
@@ -34,60 +40,32 @@ bool ModbusClient::spin() {
             break;
 
         case ModbusState::RECV_MBAP:
+        case ModbusState::RECV_PDU:
+        case ModbusState::PROCESS_REQUEST: // complete request left over from the previous pass
             if (!client.connected()) {
                 state = ModbusState::CEASING_CONNECTION; // If client disconnected, cease connection
                 break;
             }
 
-            if (client.available()) {
-                mbap[mbapReceived++] = client.read(); // Read one byte at a time
-            }
+            busy = receiveFrame(); // Pull whatever part of the frame is already buffered
 
-            if ( mbapReceived >= mbapLength) {
-                pduLength = (mbap[4] << 8 | mbap[5])-1;
-                pduReceived = 0; // Reset the PDU received counter
-                state = ModbusState::RECV_PDU;
-                busy = true;
-            }
-            break;
-
-        case ModbusState::RECV_PDU:
-            if (!client.connected()) {
-                state = ModbusState::CEASING_CONNECTION; // If client disconnected, cease connection
-                break;
-            }
-            // Read the PDU data
-            if (pduReceived < pduLength && client.available()) {
-                pdu[pduReceived++] = client.read(); // Read one byte at a time
-                busy = true; // Mark as busy since we are receiving data
+            // Answer every complete request already queued in the socket,
+            // responses are collected and sent in one write
+            for (int i = 0; i < MODBUS_PIPELINE_DEPTH && state == ModbusState::PROCESS_REQUEST; i++) {
+                processRequest(); // Append the response to the send buffer
+                mbapReceived = 0;
+                state = ModbusState::RECV_MBAP;
+                receiveFrame(); // Next request, if the client has already sent it
             }
-            // If we have received enough bytes for the PDU, process the request
 
-            if (pduReceived >= pduLength) {
-                state = ModbusState::PROCESS_REQUEST;
+            if (sendbufLength > 0) {
+                client.write(sendbuf, sendbufLength);
+                METRIC_ADD(modbusBytesOut, sendbufLength);
+                sendbufLength = 0;
                 busy = true;
             }
             break;
 
-        case ModbusState::PROCESS_REQUEST:
-
-            processRequest(); // Call a function to process the request and prepare the response
-            
-            state = ModbusState::SENDING_RESPONSE;
-            busy = true;
-            break;
-
-        case ModbusState::SENDING_RESPONSE:
-            if (!client.connected()) {
-                state = ModbusState::CEASING_CONNECTION; // If client disconnected, cease connection
-                break;
-            }
-
-            client.write(sendbuf, sendbufLength);
-            //client.stop(); // Close the connection
-            busy = true;
-            state = ModbusState::START_RECV; // start receiving new packets
-            break;
         case ModbusState::CEASING_CONNECTION:
             DEBUG("SOCKET: ");
             DEBUG(client.getSocketNumber());
@@ -101,14 +79,79 @@ bool ModbusClient::spin() {
     return busy;
 }
 
-void ModbusClient::processRequest() {
-    
-    //validate the MBAP header
-    int pid = (mbap[2] << 8) | mbap[3]; // Protocol ID
-    if (pid != 0) {
-        return; // Only Protocol ID 0 is valid for Modbus
+int ModbusClient::readAvailable(unsigned char *buf, int len) {
+    int avail = client.available();
+    if (avail <= 0 || len <= 0) return 0;
+    if (avail > len) avail = len;
+
+    int n = client.read(buf, avail); // Bulk read from the socket buffer
+    if (n <= 0) return 0;
+    METRIC_ADD(modbusBytesIn, n);
+    return n;
+}
+
+bool ModbusClient::receiveFrame() {
+    bool busy = false;
+    int n = 0;
+
+    if (state == ModbusState::RECV_MBAP) {
+        n = readAvailable(&mbap[mbapReceived], mbapLength - mbapReceived);
+        mbapReceived += n;
+        busy = n > 0;
+
+        if (mbapReceived < mbapLength) {
+            return busy; // header not complete yet
+        }
+
+        int pid = (mbap[2] << 8) | mbap[3]; // Protocol ID
+        pduLength = ((mbap[4] << 8) | mbap[5]) - 1; // Length field counts the Unit ID
+
+        // The length field is the only framing information in Modbus TCP,
+        // if it is not trusted there is no way to find the next frame
+        if (pid != 0 || pduLength < 1 || pduLength > MODBUS_MAX_PDU_LENGTH) {
+            DEBUG("SOCKET: ");
+            DEBUG(client.getSocketNumber());
+            DEBUGLN(" Bad MBAP header, dropping connection.");
+            state = ModbusState::CEASING_CONNECTION;
+            return true;
+        }
+
+        // A valid request longer than the buffer keeps its head, the rest is
+        // dropped. The truncated payload then fails the byte count check of
+        // the write and is answered with an exception, the connection stays.
+        pduDiscard = 0;
+        if (pduLength > static_cast<int>(sizeof(pdu))) {
+            pduDiscard = pduLength - sizeof(pdu);
+            pduLength = sizeof(pdu);
+        }
+
+        pduReceived = 0; // Reset the PDU received counter
+        state = ModbusState::RECV_PDU;
     }
 
+    n = readAvailable(&pdu[pduReceived], pduLength - pduReceived);
+    pduReceived += n;
+    busy |= n > 0;
+
+    while (pduReceived >= pduLength && pduDiscard > 0) {
+        unsigned char scrap[16];
+        n = readAvailable(scrap, pduDiscard < static_cast<int>(sizeof(scrap)) ? pduDiscard : sizeof(scrap));
+        if (n == 0) break; // rest not arrived yet
+        pduDiscard -= n;
+        busy = true;
+    }
+
+    // If we have received enough bytes for the PDU, process the request
+    if (pduReceived >= pduLength && pduDiscard == 0) {
+        state = ModbusState::PROCESS_REQUEST;
+        busy = true;
+    }
+    return busy;
+}
+
+void ModbusClient::processRequest() {
+    // MBAP header is already validated by receiveFrame()
+
     // get data from the MBAP header and PDU
     char unitId = mbap[6]; // Get the Unit ID from the MBAP header
     ModbusFunctionCode functionCode = static_cast<ModbusFunctionCode>(pdu[0]); // Get the function code from the PDU
@@ -125,33 +168,37 @@ void ModbusClient::processRequest() {
     DEBUG(" FC: 0x");
     DEBUGHEX(static_cast<unsigned char>(functionCode));
     DEBUGLN("");
+    METRIC_INC(modbusRequests[Metrics::modbusFunctionSlot(pdu[0])]);
 
 
     unsigned char *rqPayload = &pdu[1]; // Pointer to the payload data in the PDU
     int rqPayloadLength = pduLength - 1; // Length of the payload (excluding function code)
 
-    sendbuf[0] = mbap[0]; // Transaction ID
-    sendbuf[1] = mbap[1];
-    sendbuf[2] = 0; // Protocol ID (always 0 for Modbus)
-    sendbuf[3] = 0;
+    // responses of pipelined requests are appended one after another
+    unsigned char *resp = &sendbuf[sendbufLength];
+
+    resp[0] = mbap[0]; // Transaction ID
+    resp[1] = mbap[1];
+    resp[2] = 0; // Protocol ID (always 0 for Modbus)
+    resp[3] = 0;
     //we dont know the length yet
-    sendbuf[6] = unitId;
+    resp[6] = unitId;
 
-    const int outputBufLength = sizeof(sendbuf)-mbapLength; // Length of the response payload
+    const int outputBufLength = MODBUS_ADU_SIZE - mbapLength; // Length of the response payload
     int respPayloadLength = modbusQuery(functionCode, 
         rqPayload, 
         rqPayloadLength, 
-        &sendbuf[mbapLength], 
+        &resp[mbapLength], 
         outputBufLength
     );
 
     // Length of the MBAP header (PDU len + 1)
-    sendbuf[4] = 0;
-    sendbuf[5] = respPayloadLength + 1;
+    resp[4] = 0;
+    resp[5] = respPayloadLength + 1;
+
+    // Add the response to the send buffer
+    sendbufLength += mbapLength + respPayloadLength; // 7 bytes for MBAP + PDU
 
-    // Set the length of the response buffer
-    sendbufLength = mbapLength + respPayloadLength; // 7 bytes for MBAP + 2 bytes for PDU (function code + exception code)
-    
 }
 int ModbusClient::modbusQuery(const ModbusFunctionCode &functionCode, 
                 unsigned char *rqPayload, 
@@ -187,6 +234,23 @@ int ModbusClient::modbusQuery(const ModbusFunctionCode &functionCode,
                 break;
             }
 
+#ifdef USE_HISTORY
+            if (functionCode == ModbusFunctionCode::READ_INPUT_REGISTERS &&
+                startAddress >= HISTORY_MODBUS_ADDRESS && histories != nullptr) {
+                exceptionCode = readHistoryRegisters(histories, startAddress - HISTORY_MODBUS_ADDRESS, quantity, &outputBuf[2]) ?
+                    ModbusExceptionCode::SUCCESS : ModbusExceptionCode::ILLEGAL_DATA_ADDRESS;
+                break;
+            }
+#endif // USE_HISTORY
+#ifdef USE_PROFILER
+            if (functionCode == ModbusFunctionCode::READ_INPUT_REGISTERS &&
+                startAddress >= PROFILER_MODBUS_ADDRESS && profiler != nullptr) {
+                exceptionCode = profiler->readRegisters(startAddress - PROFILER_MODBUS_ADDRESS, quantity, &outputBuf[2]) ?
+                    ModbusExceptionCode::SUCCESS : ModbusExceptionCode::ILLEGAL_DATA_ADDRESS;
+                break;
+            }
+#endif // USE_PROFILER
+
             exceptionCode = getRegisters(startAddress, quantity, &outputBuf[2], maxOutputBufLength - 2);
             
             break;
@@ -245,6 +309,73 @@ int ModbusClient::modbusQuery(const ModbusFunctionCode &functionCode,
 
             break;
         }
+        case ModbusFunctionCode::WRITE_MULTIPLE_COILS: {
+            if (rqPayloadLength < 5) {
+                exceptionCode = ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Not enough data
+                break;
+            }
+            unsigned int startAddress = (rqPayload[0] << 8) | rqPayload[1]; // Get the starting address
+            unsigned int quantity = (rqPayload[2] << 8) | rqPayload[3]; // Get the quantity of coils
+            unsigned int byteCount = rqPayload[4];
+
+            unsigned int numBytes = quantity >> 3;
+            if (quantity % 8 > 0) numBytes++;
+
+            if (quantity < 1 || quantity > 0x07B0 || byteCount != numBytes ||
+                static_cast<unsigned int>(rqPayloadLength) < 5 + byteCount) {
+                exceptionCode = ModbusExceptionCode::ILLEGAL_DATA_VALUE;
+                break;
+            }
+
+            respPayloadLength = 5; // Length of the response payload
+            outputBuf[1] = rqPayload[0]; // Echo back the address and quantity
+            outputBuf[2] = rqPayload[1];
+            outputBuf[3] = rqPayload[2];
+            outputBuf[4] = rqPayload[3];
+
+            exceptionCode = writeMultipleCoils(startAddress, quantity, &rqPayload[5]);
+            break;
+        }
+        case ModbusFunctionCode::WRITE_MULTIPLE_REGISTERS: {
+            if (rqPayloadLength < 5) {
+                exceptionCode = ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Not enough data
+                break;
+            }
+            unsigned int startAddress = (rqPayload[0] << 8) | rqPayload[1]; // Get the starting address
+            unsigned int quantity = (rqPayload[2] << 8) | rqPayload[3]; // Get the quantity of registers
+            unsigned int byteCount = rqPayload[4];
+
+            if (quantity < 1 || quantity > 0x007B || byteCount != quantity * 2 ||
+                static_cast<unsigned int>(rqPayloadLength) < 5 + byteCount) {
+                exceptionCode = ModbusExceptionCode::ILLEGAL_DATA_VALUE;
+                break;
+            }
+
+            respPayloadLength = 5; // Length of the response payload
+            outputBuf[1] = rqPayload[0]; // Echo back the address and quantity
+            outputBuf[2] = rqPayload[1];
+            outputBuf[3] = rqPayload[2];
+            outputBuf[4] = rqPayload[3];
+
+            exceptionCode = writeMultipleRegisters(startAddress, quantity, &rqPayload[5]);
+            break;
+        }
+#ifdef USE_EVENT_LOG
+        case ModbusFunctionCode::READ_FIFO_QUEUE: {
+            if (rqPayloadLength < 2) {
+                exceptionCode = ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Not enough data
+                break;
+            }
+            if (registerMap == nullptr) {
+                exceptionCode = ModbusExceptionCode::SLAVE_DEVICE_FAILURE;
+                break;
+            }
+            // the pointer address is the sequence number of the first event wanted
+            uint16_t seq = (rqPayload[0] << 8) | rqPayload[1];
+            respPayloadLength = readEventFifo(seq, outputBuf, maxOutputBufLength);
+            break;
+        }
+#endif // USE_EVENT_LOG
         default: {
             // Handle other function codes or set an exception
             exceptionCode = ModbusExceptionCode::ILLEGAL_FUNCTION; // Unsupported function code
@@ -258,37 +389,40 @@ int ModbusClient::modbusQuery(const ModbusFunctionCode &functionCode,
         // If there was an exception, set the exception code in the response
         outputBuf[0] |= 0x80; // Set the exception flag
         outputBuf[1] = static_cast<unsigned char>(exceptionCode); // Set the exception code
+        METRIC_INC(modbusExceptions[outputBuf[1] < METRICS_MODBUS_EXCEPTIONS ? outputBuf[1] : 0]);
         respPayloadLength = 2; // Length of the response payload
     }
 
     return respPayloadLength; // Return the length of the response payload
 }
 
+// map the result of a device setter to a Modbus exception
+static ModbusExceptionCode setterException(setterOutput setterOut) {
+    if (setterOut == setterOutput::OK) {
+        return ModbusExceptionCode::SUCCESS;
+    } else if (setterOut == setterOutput::NOT_SUPPORTED) {
+        return ModbusExceptionCode::ILLEGAL_FUNCTION; // Function not supported
+    } else if (setterOut == setterOutput::READ_ONLY) {
+        return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Value is read-only
+    } else if (setterOut == setterOutput::INVALID_VALUE) {
+        return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Invalid value
+    }
+    return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Device failed to set the value
+}
+
 ModbusExceptionCode ModbusClient::writeSingleCoil(unsigned int address, bool value) {
-    
-    setterOutput setterOut = setterOutput::OK; // Initialize the setter output
+    if (registerMap == nullptr || registerImage == nullptr) {
+        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE;
+    }
 
     // Find the corresponding ModbusNode for the address
-    for (ModbusNode *node = registerTable; node->dev != nullptr; ++node) {
-        if (node->startAddress == address && node->type == setValueType::BOOL) {
-            setValue val;
-            val.b = value;
-            setterOut = node->dev->set(val); // Set the value in the device
-            
-            // handle the output of the setter
-            if (setterOut == setterOutput::NOT_SUPPORTED) {
-                return ModbusExceptionCode::ILLEGAL_FUNCTION; // Function not supported
-            } else if (setterOut == setterOutput::READ_ONLY) {
-                return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Value is read-only
-            } else if (setterOut == setterOutput::INVALID_VALUE) {
-                return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Invalid value
-            } else if (setterOut != setterOutput::OK) {
-                return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Device failed to set the value
-            }
-
-            //OK
-            return ModbusExceptionCode::SUCCESS;
-        }
+    ModbusNode *node = registerMap->findBit(address);
+    if (node != nullptr && node->startAddress == address) {
+        setValue val;
+        val.b = value;
+        ModbusExceptionCode exceptionCode = setterException(node->dev->setMany(node->channel, 1, &val)); // Set the value in the device
+        registerImage->refreshNode(node); // Make the write visible to following reads
+        return exceptionCode;
     }
     
     //if match address not found
@@ -296,74 +430,137 @@ ModbusExceptionCode ModbusClient::writeSingleCoil(unsigned int address, bool val
                                 
 }
 
+ModbusExceptionCode ModbusClient::writeMultipleCoils(unsigned int startAddress,
+                                          unsigned int quantity,
+                                          const unsigned char *values) {
+    if (registerMap == nullptr || registerImage == nullptr || values == nullptr) {
+        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE;
+    }
+
+    setValue batch[MODBUS_BATCH_SIZE];
+
+    // First pass: validate every coil, nothing is written if any of them fails
+    for (unsigned int i = 0; i < quantity; ) {
+        ModbusNode *node = registerMap->findBit(startAddress + i);
+        if (node == nullptr || node->startAddress != startAddress + i) {
+            return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
+        }
+
+        // consecutive channels of one device are validated in one call
+        unsigned int n = node->batchLength(quantity - i);
+        for (unsigned int k = 0; k < n; k++) {
+            batch[k].b = (values[(i + k) >> 3] >> ((i + k) & 0x07)) & 0x01; // first coil is at LSB of the first byte
+        }
+        ModbusExceptionCode exceptionCode = setterException(node->dev->canSetMany(node->channel, n, batch));
+        if (exceptionCode != ModbusExceptionCode::SUCCESS) {
+            return exceptionCode;
+        }
+        i += n;
+    }
+
+    // Second pass: apply all coils at once
+    ModbusExceptionCode result = ModbusExceptionCode::SUCCESS;
+    for (unsigned int i = 0; i < quantity; ) {
+        ModbusNode *node = registerMap->findBit(startAddress + i);
+
+        unsigned int n = node->batchLength(quantity - i);
+        for (unsigned int k = 0; k < n; k++) {
+            batch[k].b = (values[(i + k) >> 3] >> ((i + k) & 0x07)) & 0x01;
+        }
+        ModbusExceptionCode exceptionCode = setterException(node->dev->setMany(node->channel, n, batch));
+        for (unsigned int k = 0; k < n; k++) {
+            registerImage->refreshNode(&node[k]);
+        }
+        if (exceptionCode != ModbusExceptionCode::SUCCESS) {
+            result = exceptionCode; // keep going, the other coils are already validated
+        }
+        i += n;
+    }
+    return result;
+}
+
+// Nodes from node on which fit into the registers up to endAddress and can
+// be written with one setMany() call, the values are decoded into batch
+static unsigned int registerBatch(ModbusNode *node, unsigned int endAddress,
+                                  unsigned int startAddress, const unsigned char *values,
+                                  setValue *batch) {
+    unsigned int n = node->batchLength(endAddress - node->startAddress);
+
+    // a multi register value can only be written as a whole
+    while (n > 0 && node[n - 1].startAddress + node[n - 1].quantity > endAddress) {
+        n--;
+    }
+    for (unsigned int k = 0; k < n; k++) {
+        batch[k] = node[k].decode(&values[(node[k].startAddress - startAddress) * 2]);
+    }
+    return n;
+}
+
+ModbusExceptionCode ModbusClient::writeMultipleRegisters(unsigned int startAddress,
+                                          unsigned int quantity,
+                                          const unsigned char *values) {
+    if (registerMap == nullptr || registerImage == nullptr || values == nullptr) {
+        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE;
+    }
+
+    unsigned int endAddress = startAddress + quantity;
+    setValue batch[MODBUS_BATCH_SIZE];
+
+    // First pass: validate every register, nothing is written if any of them fails
+    for (unsigned int addr = startAddress; addr < endAddress; ) {
+        ModbusNode *node = registerMap->findRegister(addr);
+        if (node == nullptr || node->startAddress != addr) {
+            return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
+        }
+
+        unsigned int n = registerBatch(node, endAddress, startAddress, values, batch);
+        if (n == 0) {
+            return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Value cut by the end of the block
+        }
+
+        ModbusExceptionCode exceptionCode = setterException(node->dev->canSetMany(node->channel, n, batch));
+        if (exceptionCode != ModbusExceptionCode::SUCCESS) {
+            return exceptionCode;
+        }
+        addr = node[n - 1].startAddress + node[n - 1].quantity;
+    }
+
+    // Second pass: apply all registers at once
+    ModbusExceptionCode result = ModbusExceptionCode::SUCCESS;
+    for (unsigned int addr = startAddress; addr < endAddress; ) {
+        ModbusNode *node = registerMap->findRegister(addr);
+
+        unsigned int n = registerBatch(node, endAddress, startAddress, values, batch);
+        ModbusExceptionCode exceptionCode = setterException(node->dev->setMany(node->channel, n, batch));
+        for (unsigned int k = 0; k < n; k++) {
+            registerImage->refreshNode(&node[k]);
+        }
+        if (exceptionCode != ModbusExceptionCode::SUCCESS) {
+            result = exceptionCode; // keep going, the other registers are already validated
+        }
+        addr = node[n - 1].startAddress + node[n - 1].quantity;
+    }
+    return result;
+}
+
 ModbusExceptionCode ModbusClient::getDiscreteInputs(unsigned int startAddress, 
                                           unsigned int quantity, 
                                           unsigned char *outputBuf, 
                                           const unsigned int &maxOutputBufLength) {
-    if (registerTable == nullptr || outputBuf == nullptr || maxOutputBufLength <= 0) {
+    if (registerImage == nullptr || outputBuf == nullptr || maxOutputBufLength <= 0) {
         return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Invalid parameters
     }
 
-    // Prepare the response
-    unsigned int addr = startAddress;
-    unsigned int endAddress = startAddress + quantity;
-    unsigned int byteIndex = 0; // Index for the output buffer byte
-    unsigned char bitIndex = 0; // Index for the bit within the byte
-    bool bitValue = false; // Value of the bit to be written
-
-    //reset output buffer
+    // Check if the output buffer has enough space
     unsigned int numBytes = quantity >> 3; // div by 8 without residue, but faster
     if (quantity % 8 > 0) numBytes++;
-    for (unsigned int i = 0; i < numBytes; i++)
-        outputBuf[i] = 0;
-
-    bool found = false; // Flag to check if the address was found in the register table
-    while (addr < endAddress) {
-        found = false; // Reset the found flag for each address
-
-        // Find the corresponding ModbusNode for the address
-        for (ModbusNode *node = registerTable; node->dev != nullptr; ++node) {
-            if (node->startAddress == addr && node->type == setValueType::BOOL) {
-
-                // Check if the output buffer has enough space
-                if ((addr - startAddress) / 8 + 1 >= maxOutputBufLength) {
-                    return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
-                }
-
-                setValue value; // Initialize the value to be written
-                node->dev->get(value); // Get the current value from the device
-
-                // Write the value to the output buffer
-                switch (node->type) {
-                    case setValueType::BOOL:
-                        bitValue = value.b; // Get the boolean value
-                        break;
-                    default:
-                        return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Unsupported type
-                }
-
-                // Set the bit in the output buffer
-                // first register is at LSB of the first byte
-                outputBuf[byteIndex] |= ((bitValue ? 1 : 0) << bitIndex);
-                bitIndex++; // Move to the next bit
-                if (bitIndex >= 8) { // If we have filled the byte, move to the next byte
-                    byteIndex++;
-                    bitIndex = 0; // Reset the bit index
-                    if (byteIndex >= maxOutputBufLength) {
-                        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
-                    }
-                }
-
-                addr++; // Move to the next address
-                found = true; // Address found in the register table
-                break; // Move to the next address
-            }
-        }
+    if (numBytes > maxOutputBufLength) {
+        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
+    }
 
-        // If the address was not found in the register table, continue to the next address
-        if (!found) {
-            return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
-        }
+    // Copy the bits from the process image
+    if (!registerImage->readBits(startAddress, quantity, outputBuf)) {
+        return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
     }
     return ModbusExceptionCode::SUCCESS; // Success
 }
@@ -372,67 +569,67 @@ ModbusExceptionCode ModbusClient::getRegisters(unsigned int startAddress,
                                           unsigned int quantity, 
                                           unsigned char *outputBuf, 
                                           const unsigned int &maxOutputBufLength) {
-    if (registerTable == nullptr || outputBuf == nullptr || maxOutputBufLength <= 0) {
+    if (registerImage == nullptr || outputBuf == nullptr || maxOutputBufLength <= 0) {
         return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Invalid parameters
     }
 
-    // Prepare the response
-    unsigned int addr = startAddress;
-    unsigned int endAddress = startAddress + quantity;
-
-    int regValue = 0; // Initialize the register value
-    setValue value; // Initialize the value to be written
-
-    bool found = false; // Flag to check if the address was found in the register table
-    while (addr < endAddress) {
-        found = false; // Reset the found flag for each address
-
-        // Find the corresponding ModbusNode for the address
-        for (ModbusNode *node = registerTable; node->dev != nullptr; ++node) {
-            if (node->startAddress == addr &&
-                (node->type == setValueType::INT || node->type == setValueType::FLOAT)
-            ) {
-
-                // Check if the output buffer has enough space
-                if ((addr - startAddress) * 2 + 1 >= maxOutputBufLength) {
-                    return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
-                }
-
-                node->dev->get(value); // Get the current value from the device
-
-                // Write the value to the output buffer
-                switch (node->type) {
-                    case setValueType::INT:
-                        regValue = value.i * node->multiplier; // Get the integer value
-                        break;
-                    case setValueType::FLOAT: {
-                        regValue = static_cast<unsigned int>(value.f * node->multiplier);
-                        break;
-                    }
-                    default:
-                        return ModbusExceptionCode::ILLEGAL_DATA_VALUE; // Unsupported type
-                }
-
-                // Write the register value to the output buffer
-                unsigned int offset = (addr - startAddress) * 2; // Calculate the offset in the output buffer
-                if (offset + 1 >= maxOutputBufLength) {
-                    return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
-                }
-                outputBuf[offset] = (regValue >> 8) & 0xFF; // High byte
-                outputBuf[offset + 1] = regValue & 0xFF; // Low byte
-                
-                //TODO support muliple registers
-                addr++;
-
-                found = true; // Address found in the register table
-                break; // Move to the next address
-            }
-        }
+    // Check if the output buffer has enough space
+    if (quantity * 2 > maxOutputBufLength) {
+        return ModbusExceptionCode::SLAVE_DEVICE_FAILURE; // Buffer too small
+    }
 
-        // If the address was not found in the register table, continue to the next address
-        if (!found) {
-            return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
-        }
+    // Copy the registers from the process image,
+    // a multi register value can only be read as a whole
+    if (!registerImage->readRegisters(startAddress, quantity, outputBuf)) {
+        return ModbusExceptionCode::ILLEGAL_DATA_ADDRESS; // Address not found
     }
     return ModbusExceptionCode::SUCCESS; // Success
-}
\ No newline at end of file
+}
+
+#ifdef USE_EVENT_LOG
+// one FIFO entry, see readEventFifo()
+static void writeEvent(unsigned char *out, unsigned char source, bool on, unsigned long ms) {
+    out[0] = source;
+    out[1] = (on ? 0x80 : 0x00) | ((ms >> 16) & 0x7F);
+    out[2] = (ms >> 8) & 0xFF;
+    out[3] = ms & 0xFF;
+}
+
+unsigned int ModbusClient::readEventFifo(uint16_t seq, unsigned char *outputBuf, unsigned int maxOutputBufLength) {
+    // function code, byte count, FIFO count and the sequence number come first,
+    // the response buffer may hold fewer events than the protocol
+    unsigned int maxEvents = (MODBUS_FIFO_MAX_COUNT - 1) / 2;
+    unsigned int fits = maxOutputBufLength > 7 ? (maxOutputBufLength - 7) / 4 : 0;
+    if (fits < maxEvents) maxEvents = fits;
+
+    // overwritten or not handed out yet, start at the oldest event held
+    if (static_cast<uint16_t>(seq - eventLog.getFirst()) >
+        static_cast<uint16_t>(eventLog.getNext() - eventLog.getFirst())) {
+        seq = eventLog.getFirst();
+    }
+    outputBuf[5] = seq >> 8;
+    outputBuf[6] = seq & 0xFF;
+
+    unsigned int events = 0;
+    unsigned char *out = &outputBuf[7];
+    const DeviceEvent *event;
+    while (events < maxEvents && (event = eventLog.at(seq + events)) != nullptr) {
+        // every event is returned, so the client can count them off the sequence
+        ModbusNode *node = registerMap->findBitOf(event->dev, event->channel);
+        unsigned char source = MODBUS_EVENT_NO_ADDRESS;
+        if (node != nullptr && node->startAddress < MODBUS_EVENT_NO_ADDRESS) source = node->startAddress;
+
+        writeEvent(out, source, event->on, event->ms);
+        out += 4;
+        events++;
+    }
+
+    unsigned int fifoCount = 1 + events * 2;
+    unsigned int byteCount = 2 + fifoCount * 2;
+    outputBuf[1] = byteCount >> 8;
+    outputBuf[2] = byteCount & 0xFF;
+    outputBuf[3] = fifoCount >> 8;
+    outputBuf[4] = fifoCount & 0xFF;
+    return 3 + byteCount;
+}
+#endif // USE_EVENT_LOG
@@ -8,23 +8,19 @@
 #include "config.h"
 #include "debugSerial.h"
 #include "device/device.h"
+#include "modbusNode.h"
+#include "modbusMap.h"
+#include "modbusImage.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "history.h"
+#include "eventLog.h"
 
-struct ModbusNode {
-    Device *dev; // Pointer to the device
-    setValueType type; // Type of the device value
-    unsigned int startAddress; // Starting address for the device
-    unsigned int quantity = 1; // Number of registers for the device
-    float multiplier = 1.0; // Multiplier for the value
-
-    ModbusNode(Device *device, setValueType valueType, unsigned int address, 
-               unsigned int qty = 1, float mult = 1.0) 
-        : dev(device), type(valueType), startAddress(address), 
-          quantity(qty), multiplier(mult) {}
-          
-    //sentinel constructor for ModbusNode
-    ModbusNode() : dev(nullptr), type(setValueType::INT), startAddress(0), 
-                quantity(1), multiplier(1.0) {} // Default constructor
-};
+#define MODBUS_ADU_SIZE 64 // Max size of a single response (MBAP + PDU)
+#define MODBUS_PDU_SIZE 64 // Request PDU kept, longer multiple writes are answered with ILLEGAL_DATA_VALUE
+#define MODBUS_MAX_PDU_LENGTH 253 // Longest PDU allowed by the protocol
+#define MODBUS_FIFO_MAX_COUNT 31 // Registers of one Read FIFO Queue response, set by the protocol
+#define MODBUS_EVENT_NO_ADDRESS 0xFF // Event source of a device without a coil or discrete input below 255
 
 enum class ModbusState {
     NOT_STARTED,
@@ -33,7 +29,6 @@ enum class ModbusState {
     RECV_MBAP,
     RECV_PDU,
     PROCESS_REQUEST,
-    SENDING_RESPONSE,
     CEASING_CONNECTION,
 };
 
@@ -48,7 +43,7 @@ enum class ModbusFunctionCode {
     WRITE_MULTIPLE_REGISTERS = 0x10,
     // REPORT_SLAVE_ID = 0x11,
     // MASK_WRITE_REGISTER = 0x16,
-    // READ_FIFO_QUEUE = 0x18
+    READ_FIFO_QUEUE = 0x18
 };
 
 enum class ModbusExceptionCode {
@@ -70,31 +65,53 @@ private:
     EthernetClient client;
 
     unsigned char mbap[8]; // Buffer for incoming requests
-    unsigned char pdu[16];
-    unsigned char sendbuf[64];
+    unsigned char pdu[MODBUS_PDU_SIZE];
+    // Responses of pipelined requests, shared by all sockets: filled and written within one spin()
+    static unsigned char sendbuf[MODBUS_ADU_SIZE * MODBUS_PIPELINE_DEPTH];
     
     int mbapReceived = 0; // Number of bytes received in the MBAP header
     int pduReceived = 0; // Number of bytes received in the PDU
+    int pduDiscard = 0; // Bytes of an oversized PDU still to be read and dropped
 
     int mbapLength = 7; // Length of the MBAP header
     int pduLength = 0; // Length of the PDU
     int sendbufLength = 0; // Length of the send buffer
 
-    ModbusNode *registerTable = nullptr; // Pointer to the example register table
+    ModbusMap *registerMap = nullptr; // Indexed register table, owned by the server
+    ModbusImage *registerImage = nullptr; // Process image served to reads, owned by the server
 
     ModbusState state = ModbusState::NOT_STARTED;
 
+#ifdef USE_PROFILER
+    Profiler *profiler = nullptr; // Served as input registers from PROFILER_MODBUS_ADDRESS
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    History **histories = nullptr; // Served as input registers from HISTORY_MODBUS_ADDRESS
+#endif // USE_HISTORY
+
+    int readAvailable(unsigned char *buf, int len);
+    bool receiveFrame();
+
     public:
     ModbusClient() :
         server(nullptr),
-        registerTable(nullptr)
+        registerMap(nullptr),
+        registerImage(nullptr)
     {}
-    ModbusClient(EthernetServer *srv, ModbusNode *regs) : 
+    ModbusClient(EthernetServer *srv, ModbusMap *map, ModbusImage *image) : 
         server(srv)
     {
-        registerTable = regs; // Initialize the register table with the provided nodes
+        registerMap = map; // Use the register map built by the server
+        registerImage = image;
     };
     bool spin();
+    bool isActive();
+#ifdef USE_PROFILER
+    void setProfiler(Profiler *_profiler) { profiler = _profiler; }
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+    void setHistories(History **_histories) { histories = _histories; }
+#endif // USE_HISTORY
     bool isAssignedToMe(EthernetClient &c);
     bool tryAssignNewConnection(const EthernetClient &c);
     void processRequest();
@@ -112,6 +129,24 @@ private:
                         unsigned char *outputBuf, 
                         const unsigned int &maxOutputBufLength);
     ModbusExceptionCode writeSingleCoil(unsigned int address, bool value);
+    ModbusExceptionCode writeMultipleCoils(unsigned int startAddress,
+                        unsigned int quantity,
+                        const unsigned char *values);
+    ModbusExceptionCode writeMultipleRegisters(unsigned int startAddress,
+                        unsigned int quantity,
+                        const unsigned char *values);
+#ifdef USE_EVENT_LOG
+    // Read FIFO Queue response with the events from sequence number seq on, which
+    // is the FIFO pointer address of the request. The first register is the
+    // sequence number of the first event returned, higher than seq if events
+    // were overwritten, lower if seq was not a number handed out yet (the
+    // oldest held event then). The client asks for that number plus the
+    // events returned next, a lost response is simply asked for again.
+    // Each event takes two registers:
+    //   bit address of the device << 8 | level << 7 | ms bits 22..16, then ms bits 15..0
+    // The 23 bit millis() timestamp wraps every ~2.3 h. Returns the response payload length.
+    unsigned int readEventFifo(uint16_t seq, unsigned char *outputBuf, unsigned int maxOutputBufLength);
+#endif // USE_EVENT_LOG
 };
 
 #endif // __MODBUS_H__
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "modbusImage.h"
+
+bool ModbusImage::build(ModbusMap *_map) {
+    map = _map;
+    front = 0;
+    memset(registers, 0, sizeof(registers));
+    memset(bits, 0, sizeof(bits));
+
+    if (map == nullptr) return false;
+
+    if (map->getRegisterSlots() > MODBUS_IMAGE_REGISTERS || map->getBitCount() > MODBUS_IMAGE_BITS) {
+        DEBUGLN("Modbus: register table does not fit the process image");
+        return false;
+    }
+    return true;
+}
+
+void ModbusImage::refresh() {
+    if (map == nullptr) return;
+
+    unsigned char back = front ^ 1;
+    setValue values[MODBUS_BATCH_SIZE];
+
+    // one call per run of channels of the same device
+    ModbusNode *node = map->getRegisters();
+    unsigned int count = map->getRegisterCount();
+    for (unsigned int i = 0; i < count; ) {
+        unsigned int n = node[i].batchLength(count - i);
+        unsigned int got = node[i].dev->getMany(node[i].channel, n, values);
+        for (unsigned int k = 0; k < n; k++) {
+            unsigned int offset = node[i + k].slot * 2;
+            if (k < got) {
+                node[i + k].encode(values[k], &registers[back][offset]);
+            } else {
+                // not returned, keep serving the previous value
+                memcpy(&registers[back][offset], &registers[front][offset], node[i + k].quantity * 2);
+            }
+        }
+        i += n;
+    }
+
+    memset(bits[back], 0, sizeof(bits[back]));
+    node = map->getBits();
+    count = map->getBitCount();
+    for (unsigned int i = 0; i < count; ) {
+        unsigned int n = node[i].batchLength(count - i);
+        unsigned int got = node[i].dev->getMany(node[i].channel, n, values);
+        for (unsigned int k = 0; k < n; k++) {
+            unsigned int slot = node[i + k].slot;
+            unsigned char mask = 1 << (slot & 0x07);
+            bool on = k < got ? values[k].b : (bits[front][slot >> 3] & mask) != 0;
+            if (on) {
+                bits[back][slot >> 3] |= mask;
+            }
+        }
+        i += n;
+    }
+
+    front = back;
+}
+
+void ModbusImage::refreshNode(const ModbusNode *node) {
+    if (node == nullptr) return;
+
+    setValue value;
+    if (node->dev->getMany(node->channel, 1, &value) != 1) return;
+
+    if (node->type == setValueType::BOOL) {
+        unsigned char mask = 1 << (node->slot & 0x07);
+        if (value.b) {
+            bits[front][node->slot >> 3] |= mask;
+        } else {
+            bits[front][node->slot >> 3] &= ~mask;
+        }
+    } else {
+        node->encode(value, &registers[front][node->slot * 2]);
+    }
+}
+
+bool ModbusImage::readRegisters(unsigned int startAddress, unsigned int quantity, unsigned char *out) {
+    if (map == nullptr || out == nullptr) return false;
+    if (quantity == 0) return true;
+
+    unsigned int lastAddress = startAddress + quantity - 1;
+    ModbusNode *first = map->findRegister(startAddress);
+    ModbusNode *last = map->findRegister(lastAddress);
+
+    // the block must start and end on whole values
+    if (first == nullptr || last == nullptr ||
+        first->startAddress != startAddress ||
+        last->startAddress + last->quantity - 1 != lastAddress) {
+        return false;
+    }
+
+    // slots are assigned without gaps, so the block has no unmapped
+    // addresses only if slots advance exactly as addresses do
+    if (last->slot - first->slot != last->startAddress - first->startAddress) {
+        return false;
+    }
+
+    memcpy(out, &registers[front][first->slot * 2], quantity * 2);
+    return true;
+}
+
+bool ModbusImage::readBits(unsigned int startAddress, unsigned int quantity, unsigned char *out) {
+    if (map == nullptr || out == nullptr) return false;
+    if (quantity == 0) return true;
+
+    unsigned int lastAddress = startAddress + quantity - 1;
+    ModbusNode *first = map->findBit(startAddress);
+    ModbusNode *last = map->findBit(lastAddress);
+
+    if (first == nullptr || last == nullptr ||
+        first->startAddress != startAddress ||
+        last->startAddress != lastAddress ||
+        last->slot - first->slot != lastAddress - startAddress) {
+        return false;
+    }
+
+    unsigned int numBytes = quantity >> 3;
+    if (quantity % 8 > 0) numBytes++;
+    memset(out, 0, numBytes);
+
+    // first requested bit goes to the LSB of the first byte
+    const unsigned char *src = bits[front];
+    for (unsigned int i = 0; i < quantity; i++) {
+        unsigned int slot = first->slot + i;
+        if ((src[slot >> 3] >> (slot & 0x07)) & 0x01) {
+            out[i >> 3] |= 1 << (i & 0x07);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef MODBUS_IMAGE_H
+#define MODBUS_IMAGE_H
+
+#include <Arduino.h>
+
+#include "modbusMap.h"
+
+#define MODBUS_IMAGE_REGISTERS 16   // Max registers held in the process image
+#define MODBUS_IMAGE_BITS 32        // Max coils / discrete inputs held in the process image
+
+// Double buffered process image of all register table values.
+// It is refreshed once per scan into the back buffer and then flipped,
+// so requests are served from a consistent snapshot with a plain copy
+// instead of calling every device while the request is processed.
+class ModbusImage {
+    private:
+        ModbusMap *map = nullptr;
+        unsigned char registers[2][MODBUS_IMAGE_REGISTERS * 2]; // encoded registers, in slot order
+        unsigned char bits[2][(MODBUS_IMAGE_BITS + 7) / 8];     // packed bits, in slot order
+        unsigned char front = 0; // buffer served to clients
+
+    public:
+        // Returns false if the map does not fit into the image
+        bool build(ModbusMap *_map);
+
+        // Sample all devices into the back buffer and flip
+        void refresh();
+        // Update a single node in the served buffer, eg. after a write
+        void refreshNode(const ModbusNode *node);
+
+        // Copy a contiguous block, false if any address is not mapped
+        // or the block splits a multi register value
+        bool readRegisters(unsigned int startAddress, unsigned int quantity, unsigned char *out);
+        bool readBits(unsigned int startAddress, unsigned int quantity, unsigned char *out);
+};
+
+#endif // MODBUS_IMAGE_H
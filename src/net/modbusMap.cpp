@@ -0,0 +1,111 @@
+#include "modbusMap.h"
+
+// rank of the address space, used as the primary sort key
+static int spaceOf(const ModbusNode &node) {
+    switch (node.type) {
+        case setValueType::BOOL:
+            return 0;
+        case setValueType::INT:
+        case setValueType::FLOAT:
+        case setValueType::UINT32:
+        case setValueType::FIXED:
+            return 1;
+        default:
+            return -1; // not servable over Modbus
+    }
+}
+
+static bool lessThan(const ModbusNode &a, const ModbusNode &b) {
+    if (spaceOf(a) != spaceOf(b)) return spaceOf(a) < spaceOf(b);
+    return a.startAddress < b.startAddress;
+}
+
+bool ModbusMap::build(ModbusNode *table) {
+    bits = nullptr;
+    bitCount = 0;
+    registers = nullptr;
+    registerCount = 0;
+    registerSlots = 0;
+
+    if (table == nullptr) return false;
+
+    unsigned int count = 0;
+    while (table[count].dev != nullptr) count++;
+
+    // insertion sort, the table is small and sorted only once
+    for (unsigned int i = 1; i < count; i++) {
+        ModbusNode node = table[i];
+        unsigned int j = i;
+        while (j > 0 && lessThan(node, table[j - 1])) {
+            table[j] = table[j - 1];
+            j--;
+        }
+        table[j] = node;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        ModbusNode &node = table[i];
+
+        // bit nodes are single coils, register nodes span their encoding
+        unsigned int expected = spaceOf(node) == 0 ? 1 : ModbusNode::width(node.encoding);
+
+        if (spaceOf(node) < 0 || node.quantity != expected ||
+                node.channel >= node.dev->getChannelCount()) {
+            DEBUG("Modbus: unsupported node ");
+            DEBUGLN(node.dev->getName());
+            return false;
+        }
+
+        // reject duplicate or overlapping ranges within the same space
+        if (i > 0 && spaceOf(table[i - 1]) == spaceOf(node)) {
+            const ModbusNode &prev = table[i - 1];
+            if (static_cast<unsigned long>(prev.startAddress) + prev.quantity > node.startAddress) {
+                DEBUG("Modbus: address overlap at ");
+                DEBUGLN(node.startAddress);
+                return false;
+            }
+        }
+
+        // slots are the node positions in the process image
+        if (spaceOf(node) == 0) {
+            if (bits == nullptr) bits = &node;
+            node.slot = bitCount;
+            bitCount++;
+        } else {
+            if (registers == nullptr) registers = &node;
+            node.slot = registerSlots;
+            registerSlots += node.quantity;
+            registerCount++;
+        }
+    }
+
+    return true;
+}
+
+ModbusNode* ModbusMap::find(ModbusNode *nodes, unsigned int count, unsigned int address) {
+    if (nodes == nullptr) return nullptr;
+
+    // binary search for the last node starting at or below the address
+    unsigned int lo = 0;
+    unsigned int hi = count;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (nodes[mid].startAddress <= address) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return nullptr;
+
+    ModbusNode *node = &nodes[lo - 1];
+    if (address - node->startAddress >= node->quantity) return nullptr;
+    return node;
+}
+
+ModbusNode* ModbusMap::findBitOf(Device *dev, uint8_t channel) {
+    for (unsigned int i = 0; i < bitCount; i++) {
+        if (bits[i].dev == dev && bits[i].channel == channel) return &bits[i];
+    }
+    return nullptr;
+}
@@ -0,0 +1,41 @@
+#ifndef MODBUS_MAP_H
+#define MODBUS_MAP_H
+
+#include <Arduino.h>
+
+#include "debugSerial.h"
+#include "modbusNode.h"
+
+// Sorted view of the register table. The table is sorted in place once at
+// server start, grouped by address space and ordered by start address,
+// so every lookup is a binary search instead of a walk over all nodes.
+class ModbusMap {
+    private:
+        ModbusNode *bits = nullptr;         // BOOL nodes (coils / discrete inputs)
+        unsigned int bitCount = 0;
+        ModbusNode *registers = nullptr;    // INT/FLOAT nodes (holding / input registers)
+        unsigned int registerCount = 0;
+        unsigned int registerSlots = 0;     // registers spanned by all register nodes
+
+        static ModbusNode* find(ModbusNode *nodes, unsigned int count, unsigned int address);
+
+    public:
+        // Sort and index the sentinel terminated table.
+        // Returns false if the table has overlapping/duplicate addresses
+        // or nodes which can not be served.
+        bool build(ModbusNode *table);
+
+        // Return the node covering the address or nullptr
+        ModbusNode* findBit(unsigned int address) { return find(bits, bitCount, address); }
+        ModbusNode* findRegister(unsigned int address) { return find(registers, registerCount, address); }
+        // Return the bit node of a device channel or nullptr, walks all bit nodes
+        ModbusNode* findBitOf(Device *dev, uint8_t channel);
+
+        ModbusNode* getBits() { return bits; }
+        unsigned int getBitCount() { return bitCount; }
+        ModbusNode* getRegisters() { return registers; }
+        unsigned int getRegisterCount() { return registerCount; }
+        unsigned int getRegisterSlots() { return registerSlots; }
+};
+
+#endif // MODBUS_MAP_H
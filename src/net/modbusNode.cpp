@@ -0,0 +1,227 @@
+#include "modbusNode.h"
+
+#include <limits.h>
+
+// round and saturate instead of wrapping around, NaN reads as 0
+static int32_t toInt32(float v, int32_t lo, int32_t hi) {
+    if (v != v) return 0;
+    if (v <= static_cast<float>(lo)) return lo;
+    if (v >= static_cast<float>(hi)) return hi;
+    return static_cast<int32_t>(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static uint32_t toUint32(float v, uint32_t hi) {
+    if (v != v || v <= 0) return 0;
+    if (v >= static_cast<float>(hi)) return hi;
+    return static_cast<uint32_t>(v + 0.5f);
+}
+
+unsigned int ModbusNode::width(ModbusEncoding enc) {
+    switch (enc) {
+        case ModbusEncoding::INT32:
+        case ModbusEncoding::UINT32:
+        case ModbusEncoding::FLOAT32:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+unsigned int ModbusNode::batchLength(unsigned int left) const {
+    unsigned int n = 1;
+    // stops at the sentinel, at an address gap and at the other address space
+    while (n < left && n < MODBUS_BATCH_SIZE &&
+           this[n].dev == dev && this[n].type == type &&
+           this[n].channel == channel + n &&
+           this[n].startAddress == this[n - 1].startAddress + this[n - 1].quantity) {
+        n++;
+    }
+    return n;
+}
+
+int8_t ModbusNode::decimalScale(float mult) {
+    // only exact powers of ten keep the integer path, up to 10^6 either way
+    bool reciprocal = mult < 1.0f;
+    float m = reciprocal ? 1.0f / mult : mult;
+    float p = 1.0f;
+    for (int8_t k = 0; k <= 6; k++) {
+        if (m > p * 0.9999f && m < p * 1.0001f) return reciprocal ? -k : k;
+        p *= 10.0f;
+    }
+    return MODBUS_NO_SCALE;
+}
+
+// saturate an integer to the range of the encoding
+static uint32_t clampTo(int32_t v, ModbusEncoding enc) {
+    switch (enc) {
+        case ModbusEncoding::INT16:
+            return static_cast<uint16_t>(v < -32768L ? -32768L : (v > 32767L ? 32767L : v));
+        case ModbusEncoding::UINT16:
+            return v < 0 ? 0 : (v > 65535L ? 65535UL : v);
+        case ModbusEncoding::UINT32:
+            return v < 0 ? 0 : v;
+        default:
+            return static_cast<uint32_t>(v);
+    }
+}
+
+// integer only encoding of counters and fixed point values, false if it
+// needs the float path
+bool ModbusNode::encodeExact(const setValue &value, uint32_t &raw) const {
+    if (encoding == ModbusEncoding::FLOAT32) return false;
+
+    if (type == setValueType::FIXED && scale != MODBUS_NO_SCALE) {
+        int32_t units = fixedRescale(value.x.mantissa, value.x.exponent + scale, 0);
+        raw = clampTo(units, encoding);
+        return true;
+    }
+
+    // counters keep all 32 bits when they are not scaled, a float has only 24
+    if (type == setValueType::UINT32 && scale == 0) {
+        if (encoding == ModbusEncoding::UINT16) {
+            raw = value.u > 65535UL ? 65535UL : value.u;
+            return true;
+        }
+        if (encoding == ModbusEncoding::UINT32) {
+            raw = value.u;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModbusNode::encode(const setValue &value, unsigned char *out) const {
+    uint32_t raw = 0;
+
+    if (!encodeExact(value, raw)) {
+        float scaled;
+        if (type == setValueType::FLOAT) {
+            scaled = value.f * multiplier;
+        } else if (type == setValueType::UINT32) {
+            scaled = value.u * multiplier;
+        } else if (type == setValueType::FIXED) {
+            scaled = fixedToFloat(value.x) * multiplier;
+        } else {
+            scaled = value.i * multiplier;
+        }
+
+        switch (encoding) {
+            case ModbusEncoding::INT16:
+                raw = static_cast<uint16_t>(toInt32(scaled, -32768L, 32767L));
+                break;
+            case ModbusEncoding::UINT16:
+                raw = toUint32(scaled, 65535UL);
+                break;
+            case ModbusEncoding::INT32:
+                raw = static_cast<uint32_t>(toInt32(scaled, -2147483647L - 1, 2147483647L));
+                break;
+            case ModbusEncoding::UINT32:
+                raw = toUint32(scaled, 4294967295UL);
+                break;
+            case ModbusEncoding::FLOAT32:
+                memcpy(&raw, &scaled, sizeof(raw));
+                break;
+        }
+    }
+
+    uint16_t hiWord = raw >> 16;
+    uint16_t loWord = raw & 0xFFFF;
+
+    if (width(encoding) == 1) {
+        out[0] = loWord >> 8;
+        out[1] = loWord & 0xFF;
+        return;
+    }
+
+    if (wordOrder == ModbusWordOrder::LOW_WORD_FIRST) {
+        uint16_t tmp = hiWord;
+        hiWord = loWord;
+        loWord = tmp;
+    }
+    out[0] = hiWord >> 8;
+    out[1] = hiWord & 0xFF;
+    out[2] = loWord >> 8;
+    out[3] = loWord & 0xFF;
+}
+
+setValue ModbusNode::decode(const unsigned char *in) const {
+    uint32_t raw = (static_cast<uint16_t>(in[0]) << 8) | in[1];
+
+    if (width(encoding) == 2) {
+        uint16_t second = (static_cast<uint16_t>(in[2]) << 8) | in[3];
+        if (wordOrder == ModbusWordOrder::LOW_WORD_FIRST) {
+            raw |= static_cast<uint32_t>(second) << 16;
+        } else {
+            raw = (raw << 16) | second;
+        }
+    }
+
+    setValue value;
+
+    if (type == setValueType::FIXED && scale != MODBUS_NO_SCALE &&
+            encoding != ModbusEncoding::FLOAT32) {
+        // registers hold whole units of 10^-scale
+        int32_t units;
+        switch (encoding) {
+            case ModbusEncoding::INT16:
+                units = static_cast<int16_t>(raw);
+                break;
+            case ModbusEncoding::UINT16:
+                units = static_cast<uint16_t>(raw);
+                break;
+            case ModbusEncoding::UINT32:
+                units = raw > 2147483647UL ? 2147483647L : raw;
+                break;
+            default:
+                units = static_cast<int32_t>(raw);
+                break;
+        }
+        value.x.mantissa = units;
+        value.x.exponent = -scale;
+        return value;
+    }
+
+    // counters keep all 32 bits when they are not scaled, a float has only 24
+    if (type == setValueType::UINT32 && scale == 0 && encoding != ModbusEncoding::FLOAT32) {
+        if (encoding == ModbusEncoding::INT16) {
+            value.u = static_cast<int16_t>(raw) < 0 ? 0 : raw;
+        } else if (encoding == ModbusEncoding::INT32) {
+            value.u = static_cast<int32_t>(raw) < 0 ? 0 : raw;
+        } else {
+            value.u = raw;
+        }
+        return value;
+    }
+
+    float number = 0;
+    switch (encoding) {
+        case ModbusEncoding::INT16:
+            number = static_cast<int16_t>(raw);
+            break;
+        case ModbusEncoding::UINT16:
+            number = static_cast<uint16_t>(raw);
+            break;
+        case ModbusEncoding::INT32:
+            number = static_cast<int32_t>(raw);
+            break;
+        case ModbusEncoding::UINT32:
+            number = raw;
+            break;
+        case ModbusEncoding::FLOAT32:
+            memcpy(&number, &raw, sizeof(number));
+            break;
+    }
+    number /= multiplier;
+
+    if (type == setValueType::FLOAT) {
+        value.f = number;
+    } else if (type == setValueType::UINT32) {
+        value.u = toUint32(number, 4294967295UL);
+    } else if (type == setValueType::FIXED) {
+        value.x.mantissa = toInt32(number * 1000.0f, -2147483647L - 1, 2147483647L);
+        value.x.exponent = -3;
+    } else {
+        value.i = toInt32(number, INT_MIN, INT_MAX);
+    }
+    return value;
+}
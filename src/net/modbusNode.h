@@ -0,0 +1,72 @@
+#ifndef MODBUS_NODE_H
+#define MODBUS_NODE_H
+
+#include <Arduino.h>
+
+#include "device/device.h"
+
+#define MODBUS_NO_SCALE -128 // multiplier is not a power of ten
+#define MODBUS_BATCH_SIZE 8  // Channels of one device read or written in one call
+
+// How a register node value is packed into 16 bit registers
+enum class ModbusEncoding {
+    INT16,      // 1 register, signed
+    UINT16,     // 1 register
+    INT32,      // 2 registers, signed
+    UINT32,     // 2 registers
+    FLOAT32     // 2 registers, IEEE-754 single precision
+};
+
+// Order of the registers of a 32 bit value
+enum class ModbusWordOrder {
+    HIGH_WORD_FIRST,    // big endian, Modbus convention
+    LOW_WORD_FIRST      // word swapped
+};
+
+struct ModbusNode {
+    Device *dev; // Pointer to the device
+    setValueType type; // Type of the device value
+    unsigned int startAddress; // Starting address for the device
+    unsigned int quantity = 1; // Number of registers for the device
+    float multiplier = 1.0; // Multiplier for the value
+    ModbusEncoding encoding = ModbusEncoding::INT16; // Register encoding of the value
+    ModbusWordOrder wordOrder = ModbusWordOrder::HIGH_WORD_FIRST; // Order of 32 bit words
+    unsigned int slot = 0; // Position in the process image, assigned by ModbusMap
+    int8_t scale = 0; // multiplier as a power of ten, for integer only scaling
+    uint8_t channel = 0; // Channel of the device served by this node
+
+    ModbusNode(Device *device, setValueType valueType, unsigned int address, 
+               unsigned int qty = 1, float mult = 1.0, uint8_t ch = 0) 
+        : dev(device), type(valueType), startAddress(address), 
+          quantity(qty), multiplier(mult), scale(decimalScale(mult)), channel(ch) {}
+
+    // register node, spans as many registers as the encoding needs
+    ModbusNode(Device *device, setValueType valueType, unsigned int address,
+               ModbusEncoding enc, float mult = 1.0,
+               ModbusWordOrder order = ModbusWordOrder::HIGH_WORD_FIRST, uint8_t ch = 0)
+        : dev(device), type(valueType), startAddress(address),
+          quantity(width(enc)), multiplier(mult), encoding(enc), wordOrder(order),
+          scale(decimalScale(mult)), channel(ch) {}
+          
+    //sentinel constructor for ModbusNode
+    ModbusNode() : dev(nullptr), type(setValueType::INT), startAddress(0), 
+                quantity(1), multiplier(1.0) {} // Default constructor
+
+    // Number of registers used by the encoding
+    static unsigned int width(ModbusEncoding enc);
+    // k if mult is 10^k, MODBUS_NO_SCALE otherwise
+    static int8_t decimalScale(float mult);
+    // Integer only encoding, false if the value needs the float path
+    bool encodeExact(const setValue &value, uint32_t &raw) const;
+
+    // Nodes from this one on which hold the next channels of the same device
+    // at the next addresses, so they can be served by one getMany()/setMany()
+    unsigned int batchLength(unsigned int left) const;
+
+    // Pack the device value into quantity registers (2 bytes each)
+    void encode(const setValue &value, unsigned char *out) const;
+    // Unpack quantity registers into the device value
+    setValue decode(const unsigned char *in) const;
+};
+
+#endif // MODBUS_NODE_H
@@ -3,10 +3,25 @@
 bool ModbusServer::spin() {
     bool busy = false;
 
+    if (invalidTable) return false;
+
     if (!started) {
+        // index the register table once, refuse to serve ambiguous addresses
+        if (!registerMap.build(registerTable) || !registerImage.build(&registerMap)) {
+            DEBUGLN("Modbus register table invalid, server not started");
+            invalidTable = true;
+            return false;
+        }
+
         server.begin();
         for (size_t i = 0; i < MODBUS_SOCKETS; i++) {
-            socket[i] = ModbusClient(&server,registerTable);
+            socket[i] = ModbusClient(&server,&registerMap,&registerImage);
+#ifdef USE_PROFILER
+            socket[i].setProfiler(profiler);
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+            socket[i].setHistories(histories);
+#endif // USE_HISTORY
         }
         started = true;
         return true;
@@ -26,15 +41,34 @@ bool ModbusServer::spin() {
         }
         if (!duplicate) {
             //find available client
-            for (size_t i = 0; i < MODBUS_SOCKETS; i++) {
+            size_t i = 0;
+            for (; i < MODBUS_SOCKETS; i++) {
                 if (socket[i].tryAssignNewConnection(newClient)) {
                     DEBUG("New Modbus connection assigned to socket");
                     DEBUGLN(newClient.getSocketNumber());
                     break;
                 }
             }
+#ifdef USE_METRICS
+            if (i < MODBUS_SOCKETS) {
+                metrics.modbusAccepted++;
+                rejectedSocket = 0xFF;
+            } else if (newClient.getSocketNumber() != rejectedSocket) {
+                // all sockets busy, the connection waits in the backlog
+                metrics.modbusRejected++;
+                rejectedSocket = newClient.getSocketNumber();
+            }
+#endif // USE_METRICS
         }
     }
+    // take one snapshot of all devices per scan, only if someone can read it
+    for (size_t i = 0; i < MODBUS_SOCKETS; i++) {
+        if (socket[i].isActive()) {
+            registerImage.refresh();
+            break;
+        }
+    }
+
     for (size_t i = 0; i < MODBUS_SOCKETS; i++) {
         busy |= socket[i].spin();
     }
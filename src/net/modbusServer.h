@@ -2,14 +2,28 @@
 #define MODBUS_SERVER_H
 
 #include "modbus.h"
+#include "task.h"
 
-class ModbusServer {
+class ModbusServer : public Task {
     private:
         EthernetServer server;
         ModbusNode *registerTable = nullptr; // Pointer to the example register table
+        ModbusMap registerMap; // Sorted index over the register table
+        ModbusImage registerImage; // Values served to reads, refreshed once per scan
         ModbusClient socket[MODBUS_SOCKETS];
 
         bool started = false;
+        bool invalidTable = false; // Register table rejected at start
+#ifdef USE_METRICS
+        uint8_t rejectedSocket = 0xFF; // Count a waiting connection once, not every pass
+#endif // USE_METRICS
+
+#ifdef USE_PROFILER
+        Profiler *profiler = nullptr;
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+        History **histories = nullptr;
+#endif // USE_HISTORY
 
     public:
         ModbusServer(ModbusNode *regs, uint16_t port) : 
@@ -22,7 +36,18 @@ class ModbusServer {
         {
             registerTable = regs; // Initialize the register table with the provided nodes
         };
-        bool spin();
+        bool spin() override;
+        unsigned long nextSpin() override { return TASK_POLL_INTERVAL; }
+        const char* getName() override { return "modbus"; }
+
+#ifdef USE_PROFILER
+        // Serve the profiler statistics as input registers
+        void attachProfiler(Profiler *_profiler) { profiler = _profiler; }
+#endif // USE_PROFILER
+#ifdef USE_HISTORY
+        // Serve the device histories as input registers, null-terminated list
+        void attachHistories(History **_histories) { histories = _histories; }
+#endif // USE_HISTORY
 
 };
 
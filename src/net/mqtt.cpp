@@ -0,0 +1,297 @@
+#include "mqtt.h"
+
+bool Mqtt::spin() {
+    bool busy = false;
+    unsigned long now = millis();
+
+    switch (state) {
+        case MqttState::NOT_STARTED:
+            if (Ethernet.hardwareStatus() != EthernetNoHardware) {
+                client.setConnectionTimeout(MQTT_CONNECT_TIMEOUT);
+                connect();
+                busy = true;
+            }
+            break;
+
+        case MqttState::DISCONNECTED:
+            if (now - ts > backoff) {
+                connect();
+                busy = true;
+            }
+            break;
+
+        case MqttState::WAIT_CONNACK:
+        case MqttState::CONNECTED:
+            if (!client.connected()) {
+                DEBUGLN("MQTT: connection lost");
+                disconnect();
+                break;
+            }
+
+            busy = receive();
+
+            if (state != MqttState::CONNECTED) {
+                // broker did not accept us in time
+                if (state == MqttState::WAIT_CONNACK && now - ts > MQTT_CONNACK_TIMEOUT) {
+                    disconnect();
+                }
+                break;
+            }
+
+            // broker silent for 1.5 keep alive periods
+            if (now - rxTs > MQTT_KEEPALIVE * 1500UL) {
+                DEBUGLN("MQTT: broker timeout");
+                disconnect();
+                break;
+            }
+
+            if (Device::getSequence() != publishedSeq) {
+                publishChanges(publishedSeq);
+                busy = true;
+            } else if (now - txTs > MQTT_KEEPALIVE * 500UL) {
+                ping();
+            }
+            break;
+    }
+    return busy;
+}
+
+unsigned long Mqtt::nextSpin() {
+    if (state == MqttState::DISCONNECTED) {
+        return remaining(ts, backoff);
+    }
+    return TASK_POLL_INTERVAL;
+}
+
+void Mqtt::connect() {
+    ts = millis();
+    rxState = MqttRxState::HEADER;
+
+    // Blocks for up to MQTT_CONNECT_TIMEOUT, the Ethernet library has no
+    // non-blocking connect and keeps its sockets private. The backoff keeps
+    // an unreachable broker from stalling the scheduler every few seconds.
+    // Only the TCP handshake is waited for here, the CONNACK is not.
+    if (!client.connect(broker, port)) {
+        DEBUGLN("MQTT: broker unreachable");
+        state = MqttState::DISCONNECTED;
+        backOff();
+        return;
+    }
+
+    const size_t idLen = sizeof(MQTT_CLIENT_ID) - 1;
+
+    TxBuffer out(client);
+    out.write(static_cast<uint8_t>(MqttPacketType::CONNECT));
+    writeLength(out, 10 + 2 + idLen);
+    writeString(out, "MQTT", 4);    // protocol name
+    out.write(static_cast<uint8_t>(0x04)); // protocol level 3.1.1
+    out.write(static_cast<uint8_t>(0x02)); // clean session
+    out.write(static_cast<uint8_t>(MQTT_KEEPALIVE >> 8));
+    out.write(static_cast<uint8_t>(MQTT_KEEPALIVE & 0xFF));
+    writeString(out, MQTT_CLIENT_ID, idLen);
+    out.flush();
+
+    txTs = rxTs = millis();
+    state = MqttState::WAIT_CONNACK;
+}
+
+void Mqtt::disconnect() {
+    // a broker which refuses or never answers the CONNECT counts as a failed attempt
+    if (state == MqttState::WAIT_CONNACK) backOff();
+    client.stop();
+    ts = millis();
+    state = MqttState::DISCONNECTED;
+}
+
+void Mqtt::backOff() {
+    backoff = backoff < MQTT_RECONNECT_MAX / 2 ? backoff * 2 : MQTT_RECONNECT_MAX;
+}
+
+bool Mqtt::receive() {
+    bool busy = false;
+
+    while (client.available()) {
+        busy = true;
+        unsigned char c = client.read();
+
+        switch (rxState) {
+            case MqttRxState::HEADER:
+                rxHeader = c;
+                rxLength = 0;
+                rxShift = 0;
+                rxState = MqttRxState::LENGTH;
+                break;
+
+            case MqttRxState::LENGTH:
+                // variable length encoding, 7 bits per byte, LSB first
+                rxLength |= static_cast<unsigned long>(c & 0x7F) << rxShift;
+                rxShift += 7;
+                if (c & 0x80) {
+                    if (rxShift > 21) {
+                        disconnect(); // malformed, more than 4 length bytes
+                        return true;
+                    }
+                    break;
+                }
+                rxReceived = 0;
+                rxState = MqttRxState::BODY;
+                if (rxLength > 0) break;
+                // no body, packet complete
+                // fall through
+
+            case MqttRxState::BODY:
+                if (rxLength > 0) {
+                    // bytes beyond the buffer are skipped, the packet is ignored then
+                    if (rxReceived < MQTT_BUFFER_SIZE) rxbuf[rxReceived] = c;
+                    rxReceived++;
+                    if (rxReceived < rxLength) break;
+                }
+                rxTs = millis();
+                if (rxLength <= MQTT_BUFFER_SIZE) {
+                    processPacket();
+                }
+                rxState = MqttRxState::HEADER;
+                break;
+        }
+
+        if (state != MqttState::CONNECTED && state != MqttState::WAIT_CONNACK) {
+            break; // dropped while processing
+        }
+    }
+    return busy;
+}
+
+void Mqtt::processPacket() {
+    switch (rxHeader & 0xF0) {
+        case static_cast<unsigned char>(MqttPacketType::CONNACK):
+            if (rxLength < 2 || rxbuf[1] != 0) {
+                DEBUG("MQTT: connection refused, code ");
+                DEBUGLN(rxLength < 2 ? -1 : rxbuf[1]);
+                disconnect();
+                return;
+            }
+            DEBUGLN("MQTT: connected");
+            state = MqttState::CONNECTED;
+            backoff = MQTT_RECONNECT_INTERVAL;
+            subscribe();
+            publishChanges(0); // retained full state
+            break;
+
+        case static_cast<unsigned char>(MqttPacketType::PUBLISH):
+            processPublish();
+            break;
+
+        default:
+            // SUBACK, PINGRESP - nothing to do
+            break;
+    }
+}
+
+void Mqtt::processPublish() {
+    if (rxLength < 2) return;
+
+    size_t topicLen = (rxbuf[0] << 8) | rxbuf[1];
+    size_t offset = 2 + topicLen;
+    if ((rxHeader & 0x06) != 0) offset += 2; // packet id of QoS > 0
+    if (offset > rxLength) return;
+
+    // topic must be <prefix><name>/set
+    const size_t prefixLen = sizeof(MQTT_TOPIC_PREFIX) - 1;
+    char *topic = reinterpret_cast<char *>(&rxbuf[2]);
+    if (topicLen < prefixLen + 5 ||
+        strncmp(topic, MQTT_TOPIC_PREFIX, prefixLen) != 0 ||
+        strncmp(&topic[topicLen - 4], "/set", 4) != 0) {
+        return;
+    }
+
+    char *name = &topic[prefixLen];
+    size_t nameLen = topicLen - prefixLen - 4;
+
+    // payload as a zero terminated string
+    char payload[MAX_DEV_DATA_LEN];
+    size_t payloadLen = rxLength - offset;
+    if (payloadLen >= MAX_DEV_DATA_LEN) return;
+    memcpy(payload, &rxbuf[offset], payloadLen);
+    payload[payloadLen] = '\0';
+
+    for (Device** dev = devices; *dev != nullptr; ++dev) {
+        const char *devName = (*dev)->getName();
+        if (strlen(devName) == nameLen && strncmp(devName, name, nameLen) == 0) {
+            // the new value is published back on the next change
+            (*dev)->deserialize(payload, MAX_DEV_DATA_LEN);
+            return;
+        }
+    }
+}
+
+void Mqtt::subscribe() {
+    static const char filter[] = MQTT_TOPIC_PREFIX "+/set";
+    const size_t filterLen = sizeof(filter) - 1;
+
+    TxBuffer out(client);
+    out.write(static_cast<uint8_t>(MqttPacketType::SUBSCRIBE));
+    writeLength(out, 2 + 2 + filterLen + 1);
+    out.write(static_cast<uint8_t>(0x00)); // packet id 1
+    out.write(static_cast<uint8_t>(0x01));
+    writeString(out, filter, filterLen);
+    out.write(static_cast<uint8_t>(0x00)); // QoS 0
+    out.flush();
+
+    txTs = millis();
+}
+
+void Mqtt::publishChanges(unsigned long changedSince) {
+    for (Device** dev = devices; *dev != nullptr; ++dev) {
+        // since 0 means full state, also for devices which never changed
+        if (changedSince == 0 || (*dev)->getVersion() > changedSince) {
+            publish(*dev);
+        }
+    }
+    publishedSeq = Device::getSequence();
+}
+
+void Mqtt::publish(Device *dev) {
+    const size_t prefixLen = sizeof(MQTT_TOPIC_PREFIX) - 1;
+    const char *name = dev->getName();
+    size_t nameLen = strlen(name);
+
+    // the length is taken from the text, serialize() may return more than it
+    // wrote when the text was cut, or an error
+    char payload[MAX_DEV_DATA_LEN];
+    payload[0] = '\0';
+    dev->serialize(payload, sizeof(payload));
+    size_t payloadLen = strnlen(payload, sizeof(payload));
+
+    TxBuffer out(client);
+    out.write(static_cast<uint8_t>(MqttPacketType::PUBLISH) | 0x01); // QoS 0, retain
+    writeLength(out, 2 + prefixLen + nameLen + payloadLen);
+    out.write(static_cast<uint8_t>((prefixLen + nameLen) >> 8));
+    out.write(static_cast<uint8_t>((prefixLen + nameLen) & 0xFF));
+    out.write(MQTT_TOPIC_PREFIX, prefixLen);
+    out.write(name, nameLen);
+    out.write(payload, payloadLen);
+    out.flush();
+
+    txTs = millis();
+}
+
+void Mqtt::ping() {
+    uint8_t packet[] = { static_cast<uint8_t>(MqttPacketType::PINGREQ), 0x00 };
+    client.write(packet, sizeof(packet));
+    txTs = millis();
+}
+
+void Mqtt::writeLength(Print &out, unsigned long len) {
+    do {
+        uint8_t c = len & 0x7F;
+        len >>= 7;
+        if (len > 0) c |= 0x80;
+        out.write(c);
+    } while (len > 0);
+}
+
+void Mqtt::writeString(Print &out, const char *s, size_t len) {
+    out.write(static_cast<uint8_t>(len >> 8));
+    out.write(static_cast<uint8_t>(len & 0xFF));
+    out.write(s, len);
+}
@@ -0,0 +1,97 @@
+#ifndef MQTT_H
+#define MQTT_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+#include "config.h"
+#include "task.h"
+#include "debugSerial.h"
+#include "device/device.h"
+#include "deviceJson.h"
+#include "txStream.h"
+
+#define MQTT_BUFFER_SIZE 48         // Max size of a received packet, bigger ones are skipped
+#define MQTT_KEEPALIVE 30           // Keep alive in seconds
+#define MQTT_CONNECT_TIMEOUT 100    // ms, TCP connect blocks for up to this long, a LAN broker answers in a few
+#define MQTT_CONNACK_TIMEOUT 5000   // ms the broker has to accept the CONNECT, awaited across spins
+#define MQTT_RECONNECT_INTERVAL 5000 // ms before the first attempt after a lost connection
+#define MQTT_RECONNECT_MAX 300000UL // ms, the wait doubles with every failed attempt up to this
+#define MQTT_TOPIC_PREFIX "godbus/"
+#define MQTT_CLIENT_ID "godbus"
+
+enum class MqttState {
+    NOT_STARTED,
+    DISCONNECTED,   // waiting for the next connection attempt
+    WAIT_CONNACK,   // CONNECT sent, spin() polls for the answer
+    CONNECTED,
+};
+
+enum class MqttRxState {
+    HEADER,
+    LENGTH,
+    BODY,
+};
+
+enum class MqttPacketType {
+    CONNECT = 0x10,
+    CONNACK = 0x20,
+    PUBLISH = 0x30,
+    SUBSCRIBE = 0x82,
+    SUBACK = 0x90,
+    PINGREQ = 0xC0,
+    PINGRESP = 0xD0,
+};
+
+// Minimal MQTT 3.1.1 client, QoS 0 only.
+// Publishes each device on change to godbus/<name> with retain and
+// routes godbus/<name>/set payloads to Device::deserialize.
+class Mqtt : public Task {
+    private:
+        EthernetClient client;
+        IPAddress broker;
+        uint16_t port;
+        Device** devices = nullptr;
+
+        MqttState state = MqttState::NOT_STARTED;
+        unsigned long publishedSeq = 0; // sequence already published
+        unsigned long ts;               // last connection attempt
+        unsigned long backoff = MQTT_RECONNECT_INTERVAL; // ms before the next attempt
+        unsigned long txTs;             // last packet sent
+        unsigned long rxTs;             // last packet received
+
+        // receive side, one packet at a time
+        MqttRxState rxState = MqttRxState::HEADER;
+        unsigned char rxHeader = 0;
+        unsigned long rxLength = 0;     // remaining length of the packet
+        unsigned char rxShift = 0;      // remaining length decoding
+        unsigned long rxReceived = 0;
+        unsigned char rxbuf[MQTT_BUFFER_SIZE];
+
+        void connect();
+        void disconnect();
+        void backOff();
+        bool receive();
+        void processPacket();
+        void processPublish();
+        void subscribe();
+        void publishChanges(unsigned long changedSince);
+        void publish(Device *dev);
+        void ping();
+
+        static void writeLength(Print &out, unsigned long len);
+        static void writeString(Print &out, const char *s, size_t len);
+
+    public:
+        Mqtt(Device** _devices, IPAddress _broker, uint16_t _port = 1883) :
+            broker(_broker),
+            port(_port),
+            devices(_devices)
+        {}
+
+        bool spin() override;
+        unsigned long nextSpin() override;
+        const char* getName() override { return "mqtt"; }
+};
+
+#endif // MQTT_H
@@ -0,0 +1,33 @@
+#include "txStream.h"
+
+size_t TxBuffer::write(uint8_t c) {
+    if (len >= TX_CHUNK_SIZE) {
+        flush();
+    }
+    buf[len++] = c;
+    return 1;
+}
+
+size_t TxBuffer::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        if (len >= TX_CHUNK_SIZE) {
+            flush();
+        }
+        size_t n = TX_CHUNK_SIZE - len;
+        if (n > size - written) n = size - written;
+
+        memcpy(&buf[len], &buffer[written], n);
+        len += n;
+        written += n;
+    }
+    return written;
+}
+
+void TxBuffer::flush() {
+    if (len > 0) {
+        sink.write(buf, len);
+        total += len;
+        len = 0;
+    }
+}
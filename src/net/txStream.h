@@ -0,0 +1,40 @@
+#ifndef TX_STREAM_H
+#define TX_STREAM_H
+
+#include <Arduino.h>
+
+#define TX_CHUNK_SIZE 64 // Bytes collected before they are handed to the socket
+
+// Collects small prints into TX sized chunks, so a response is sent
+// in a few socket writes instead of one write per print call
+class TxBuffer : public Print {
+    private:
+        Print &sink; // socket the chunks are written to
+        uint8_t buf[TX_CHUNK_SIZE];
+        size_t len = 0;
+        size_t total = 0; // bytes handed to the socket so far
+
+    public:
+        TxBuffer(Print &_sink) : sink(_sink) {}
+        ~TxBuffer() { flush(); }
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+        void flush() override;
+        size_t getTotal() { return total; }
+};
+
+// Discards the output and counts it, used to precompute Content-Length
+class ByteCounter : public Print {
+    private:
+        size_t count = 0;
+
+    public:
+        size_t write(uint8_t) override { count++; return 1; }
+        size_t write(const uint8_t *, size_t size) override { count += size; return size; }
+        using Print::write;
+        size_t getCount() { return count; }
+};
+
+#endif // TX_STREAM_H
@@ -0,0 +1,68 @@
+#include "udpPublisher.h"
+
+bool UdpPublisher::isMulticast(const IPAddress &ip) {
+    return ip[0] >= 224 && ip[0] <= 239;
+}
+
+bool UdpPublisher::spin() {
+    if (!started) {
+        if (Ethernet.hardwareStatus() == EthernetNoHardware) return false;
+
+        udp.begin(port);
+
+        // a multicast group needs its own socket, only the first one is joined
+        for (size_t i = 0; i < subscriberCount; i++) {
+            if (isMulticast(subscribers[i])) {
+                multicast.beginMulticast(subscribers[i], port);
+                hasMulticast = true;
+                break;
+            }
+        }
+
+        started = true;
+        publish(0);
+        return true;
+    }
+
+    unsigned long now = millis();
+
+    if (now - heartbeatTs > UDP_HEARTBEAT_INTERVAL) {
+        publish(0);
+        return true;
+    }
+
+    // coalesce chattering inputs, the next datagram carries all changes
+    if (Device::getSequence() != publishedSeq && now - ts > UDP_MIN_INTERVAL) {
+        publish(publishedSeq);
+        return true;
+    }
+
+    return false;
+}
+
+void UdpPublisher::publish(unsigned long changedSince) {
+    bool multicastSent = false;
+
+    for (size_t i = 0; i < subscriberCount; i++) {
+        EthernetUDP *sock = &udp;
+        if (isMulticast(subscribers[i])) {
+            if (!hasMulticast || multicastSent) continue; // only the joined group
+            sock = &multicast;
+            multicastSent = true;
+        }
+
+        if (!sock->beginPacket(subscribers[i], port)) continue;
+
+        TxBuffer out(*sock);
+        writeChangesJson(out, devices, changedSince);
+        out.flush();
+
+        sock->endPacket();
+    }
+
+    publishedSeq = Device::getSequence();
+    ts = millis();
+    if (changedSince == 0) {
+        heartbeatTs = ts;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef UDP_PUBLISHER_H
+#define UDP_PUBLISHER_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+
+#include "config.h"
+#include "task.h"
+#include "debugSerial.h"
+#include "device/device.h"
+#include "deviceJson.h"
+#include "txStream.h"
+
+#define UDP_MIN_INTERVAL 50         // ms between change datagrams, faster changes are coalesced
+#define UDP_HEARTBEAT_INTERVAL 10000 // ms between full state datagrams
+
+// Pushes device changes to subscribers as JSON datagrams, in the same
+// format as GET /?since=: {"seq": 42, "devices": {"relay_1": "1"}}
+// A periodic full state datagram heals lost packets.
+class UdpPublisher : public Task {
+    private:
+        EthernetUDP udp;        // unicast subscribers
+        EthernetUDP multicast;  // multicast group, if one is subscribed
+        Device** devices = nullptr;
+        const IPAddress *subscribers = nullptr;
+        size_t subscriberCount = 0;
+        uint16_t port;
+
+        bool started = false;
+        bool hasMulticast = false;
+        unsigned long publishedSeq = 0; // sequence already sent to subscribers
+        unsigned long ts;               // last change datagram
+        unsigned long heartbeatTs;      // last full state datagram
+
+        static bool isMulticast(const IPAddress &ip);
+        void publish(unsigned long changedSince);
+
+    public:
+        UdpPublisher(Device** _devices, const IPAddress *_subscribers, size_t _count, uint16_t _port = UDP_PORT) :
+            devices(_devices),
+            subscribers(_subscribers),
+            subscriberCount(_count),
+            port(_port)
+        {}
+
+        bool spin() override;
+        unsigned long nextSpin() override { return TASK_POLL_INTERVAL; }
+        const char* getName() override { return "udp"; }
+};
+
+#endif // UDP_PUBLISHER_H
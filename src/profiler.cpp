@@ -0,0 +1,89 @@
+#include "profiler.h"
+
+#ifdef USE_PROFILER
+
+static uint16_t saturate16(uint32_t v) {
+    return v > 0xFFFF ? 0xFFFF : v;
+}
+
+int Profiler::add(Task *task) {
+    if (count >= PROFILER_MAX_TASKS) return -1;
+    tasks[count] = task;
+    stats[count] = TaskProfile();
+    return count++;
+}
+
+void Profiler::record(int slot, unsigned long us) {
+    if (slot < 0 || static_cast<size_t>(slot) >= count) return;
+    TaskProfile &p = stats[slot];
+
+    // keep the mean when the sum or the count would overflow
+    if (p.total > 0x80000000UL || p.count == 0xFFFF) {
+        p.total >>= 1;
+        p.count >>= 1;
+    }
+    p.total += us;
+    p.count++;
+
+    uint16_t us16 = saturate16(us);
+    if (us16 < p.min) p.min = us16;
+    if (us16 > p.max) p.max = us16;
+
+    unsigned char bucket = 0;
+    for (unsigned long v = us >> 4; v > 0 && bucket < PROFILER_BUCKETS - 1; v >>= 2) {
+        bucket++;
+    }
+    if (p.hist[bucket] == 0xFF) {
+        for (unsigned char b = 0; b < PROFILER_BUCKETS; b++) p.hist[b] >>= 1;
+    }
+    p.hist[bucket]++;
+}
+
+void Profiler::writeJson(Print &out) {
+    out.print(F("{"));
+    for (size_t i = 0; i < count; i++) {
+        const TaskProfile &p = stats[i];
+
+        if (i > 0) out.print(F(", "));
+        out.print(F("\""));
+        out.print(tasks[i]->getName());
+        out.print(F("\": {\"n\": "));
+        out.print(p.count);
+        out.print(F(", \"min\": "));
+        out.print(p.count ? p.min : 0);
+        out.print(F(", \"max\": "));
+        out.print(p.max);
+        out.print(F(", \"mean\": "));
+        out.print(p.count ? p.total / p.count : 0);
+        out.print(F(", \"hist\": ["));
+        for (size_t b = 0; b < PROFILER_BUCKETS; b++) {
+            if (b > 0) out.print(F(", "));
+            out.print(p.hist[b]);
+        }
+        out.print(F("]}"));
+    }
+    out.print(F("}"));
+}
+
+bool Profiler::readRegisters(unsigned int offset, unsigned int quantity, unsigned char *out) {
+    for (unsigned int i = 0; i < quantity; i++) {
+        unsigned int slot = (offset + i) / PROFILER_REGS_PER_TASK;
+        unsigned int field = (offset + i) % PROFILER_REGS_PER_TASK;
+        if (slot >= count) return false;
+
+        const TaskProfile &p = stats[slot];
+        uint16_t value = 0;
+        switch (field) {
+            case 0: value = p.count ? p.min : 0; break;
+            case 1: value = p.max; break;
+            case 2: value = p.count ? saturate16(p.total / p.count) : 0; break;
+            case 3: value = p.count; break;
+            default: value = p.hist[field - 4]; break;
+        }
+        out[i * 2] = value >> 8;
+        out[i * 2 + 1] = value & 0xFF;
+    }
+    return true;
+}
+
+#endif // USE_PROFILER
@@ -0,0 +1,47 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "task.h"
+
+#ifdef USE_PROFILER
+
+#define PROFILER_MAX_TASKS SCHEDULER_MAX_TASKS // every scheduled task has a slot
+#define PROFILER_BUCKETS 8              // log4 buckets: <16us, <64us, <256us, ... , >=64ms
+#define PROFILER_REGS_PER_TASK (4 + PROFILER_BUCKETS) // Modbus input registers per task
+#define PROFILER_MODBUS_ADDRESS 1000    // First Modbus input register of the profiler block
+
+// 18 B per task, every scheduled task has one
+struct TaskProfile {
+    uint16_t count = 0;     // samples, halved together with total to keep the mean
+    uint32_t total = 0;     // us
+    uint16_t min = 0xFFFF;  // us, saturated
+    uint16_t max = 0;       // us, saturated
+    uint8_t hist[PROFILER_BUCKETS] = {}; // all halved when one is full, keeps the shape
+};
+
+// Timing statistics of every spin() call, per task, in fixed RAM
+class Profiler {
+    private:
+        Task *tasks[PROFILER_MAX_TASKS];
+        TaskProfile stats[PROFILER_MAX_TASKS];
+        size_t count = 0;
+
+    public:
+        // Returns the slot of the task or -1 if full
+        int add(Task *task);
+        void record(int slot, unsigned long us);
+
+        // {"<task>": {"n": .., "min": .., "max": .., "mean": .., "hist": [..]}, ...}
+        void writeJson(Print &out);
+
+        // Input register block, PROFILER_REGS_PER_TASK registers per task:
+        // min, max, mean (us, saturated), samples, histogram
+        bool readRegisters(unsigned int offset, unsigned int quantity, unsigned char *out);
+};
+
+#endif // USE_PROFILER
+
+#endif // PROFILER_H
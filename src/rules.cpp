@@ -0,0 +1,254 @@
+#include "rules.h"
+
+#ifdef USE_RULES
+
+#include <EEPROM.h>
+#include "debugSerial.h"
+
+// CRC-16/CCITT
+static uint16_t crc16(uint16_t crc, uint8_t data) {
+    crc ^= static_cast<uint16_t>(data) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+RuleEngine::RuleEngine(Device **_devices) : devices(_devices) {
+    while (devices[deviceCount] != nullptr) deviceCount++;
+    for (uint8_t i = 0; i < RULE_MAX_RULES; i++) {
+        primed[i] = false;
+        active[i] = false;
+        pulsing[i] = false;
+        pulseTs[i] = 0;
+    }
+}
+
+void RuleEngine::encode(const Rule &rule, uint8_t *data) {
+    data[0] = static_cast<uint8_t>(rule.trigger) << 4 | static_cast<uint8_t>(rule.action);
+    data[1] = rule.source;
+    data[2] = rule.channel;
+    data[3] = rule.target;
+    data[4] = static_cast<uint16_t>(rule.threshold) >> 8;
+    data[5] = static_cast<uint16_t>(rule.threshold) & 0xFF;
+    data[6] = rule.hysteresis >> 8;
+    data[7] = rule.hysteresis & 0xFF;
+    data[8] = rule.time >> 8;
+    data[9] = rule.time & 0xFF;
+}
+
+void RuleEngine::decode(const uint8_t *data, Rule &rule) {
+    rule.trigger = static_cast<RuleTrigger>(data[0] >> 4);
+    rule.action = static_cast<RuleAction>(data[0] & 0x0F);
+    rule.source = data[1];
+    rule.channel = data[2];
+    rule.target = data[3];
+    rule.threshold = static_cast<int16_t>((data[4] << 8) | data[5]);
+    rule.hysteresis = (data[6] << 8) | data[7];
+    rule.time = (data[8] << 8) | data[9];
+}
+
+// the device list may have changed since the rule was written
+bool RuleEngine::valid(const Rule &rule) {
+    if (rule.trigger == RuleTrigger::NONE) return true;
+    if (rule.trigger > RuleTrigger::BELOW || rule.action > RuleAction::PULSE) return false;
+    if (rule.source >= deviceCount || rule.target >= deviceCount) return false;
+    if (rule.channel >= devices[rule.source]->getChannelCount()) return false;
+
+    Device *target = devices[rule.target];
+    setValue on;
+    on.b = true;
+    return target->getType() == setValueType::BOOL && target->canSet(on) == setterOutput::OK;
+}
+
+void RuleEngine::load() {
+    // names and their order, so an inserted or moved device is noticed, and
+    // the rule size, so a table of another layout is never decoded. Taken
+    // here rather than in the constructor, the devices are set up by then.
+    fingerprint = crc16(0xFFFF, RULE_SIZE);
+    for (uint8_t i = 0; i < deviceCount; i++) {
+        const char *name = devices[i]->getName();
+        do {
+            fingerprint = crc16(fingerprint, *name);
+        } while (*name++ != '\0');
+    }
+
+    if (EEPROM.read(RULE_EEPROM_ADDRESS) != RULE_EEPROM_MAGIC) return; // never written
+
+    uint16_t stored = (EEPROM.read(RULE_EEPROM_ADDRESS + 1) << 8) | EEPROM.read(RULE_EEPROM_ADDRESS + 2);
+    if (stored != fingerprint) {
+        DEBUGLN("Rules dropped, stored for another device list");
+        return;
+    }
+
+    uint8_t data[RULE_SIZE];
+    for (uint8_t i = 0; i < RULE_MAX_RULES; i++) {
+        for (uint8_t b = 0; b < RULE_SIZE; b++) {
+            data[b] = EEPROM.read(RULE_EEPROM_RULES + i * RULE_SIZE + b);
+        }
+        decode(data, rules[i]);
+        if (!valid(rules[i])) {
+            DEBUG("Rule dropped from EEPROM: ");
+            DEBUGLN(i);
+            rules[i] = Rule();
+        }
+        primed[i] = false;
+    }
+}
+
+// the whole table, so rules dropped at load for another device list are
+// cleared too. update() skips unchanged bytes, EEPROM cells wear out on writes.
+void RuleEngine::store() {
+    uint8_t data[RULE_SIZE];
+
+    EEPROM.update(RULE_EEPROM_ADDRESS, RULE_EEPROM_MAGIC);
+    EEPROM.update(RULE_EEPROM_ADDRESS + 1, fingerprint >> 8);
+    EEPROM.update(RULE_EEPROM_ADDRESS + 2, fingerprint & 0xFF);
+    for (uint8_t i = 0; i < RULE_MAX_RULES; i++) {
+        encode(rules[i], data);
+        for (uint8_t b = 0; b < RULE_SIZE; b++) {
+            EEPROM.update(RULE_EEPROM_RULES + i * RULE_SIZE + b, data[b]);
+        }
+    }
+}
+
+static int8_t hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool RuleEngine::set(uint8_t slot, const char *hex) {
+    if (slot >= RULE_MAX_RULES || strlen(hex) != RULE_SIZE * 2) return false;
+
+    uint8_t data[RULE_SIZE];
+    for (uint8_t b = 0; b < RULE_SIZE; b++) {
+        int8_t hi = hexDigit(hex[b * 2]);
+        int8_t lo = hexDigit(hex[b * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        data[b] = hi << 4 | lo;
+    }
+
+    Rule rule;
+    decode(data, rule);
+    if (!valid(rule)) return false;
+
+    // a running pulse of the old rule is switched off, not left on forever
+    if (pulsing[slot]) setTarget(slot, false);
+    rules[slot] = rule;
+    primed[slot] = false;
+    pulsing[slot] = false;
+    store();
+    return true;
+}
+
+// condition of a rule in this scan, with the hysteresis of the last one
+bool RuleEngine::condition(uint8_t slot) {
+    const Rule &rule = rules[slot];
+    int32_t value;
+
+    switch (rule.trigger) {
+        case RuleTrigger::RISE:
+        case RuleTrigger::CHANGE:
+            return devices[rule.source]->getFixed(rule.channel, 0, value) && value != 0;
+        case RuleTrigger::FALL:
+            return devices[rule.source]->getFixed(rule.channel, 0, value) && value == 0;
+        case RuleTrigger::ABOVE:
+            // without a reading the condition is false, a FOLLOW heater turns off
+            if (!devices[rule.source]->getFixed(rule.channel, RULE_EXPONENT, value)) return false;
+            if (active[slot]) return value >= static_cast<int32_t>(rule.threshold) - rule.hysteresis;
+            return value > rule.threshold;
+        case RuleTrigger::BELOW:
+            if (!devices[rule.source]->getFixed(rule.channel, RULE_EXPONENT, value)) return false;
+            if (active[slot]) return value <= static_cast<int32_t>(rule.threshold) + rule.hysteresis;
+            return value < rule.threshold;
+        default:
+            return false;
+    }
+}
+
+void RuleEngine::setTarget(uint8_t slot, bool on) {
+    setValue v;
+    v.b = on;
+    devices[rules[slot].target]->set(v);
+}
+
+// the condition changed to on
+void RuleEngine::run(uint8_t slot, bool on) {
+    const Rule &rule = rules[slot];
+
+    if (rule.action == RuleAction::FOLLOW) {
+        setTarget(slot, on);
+        return;
+    }
+    if (!on && rule.trigger != RuleTrigger::CHANGE) return;
+
+    switch (rule.action) {
+        case RuleAction::ON:
+            setTarget(slot, true);
+            break;
+        case RuleAction::OFF:
+            setTarget(slot, false);
+            break;
+        case RuleAction::TOGGLE: {
+            setValue v;
+            devices[rule.target]->get(v);
+            setTarget(slot, !v.b);
+            break;
+        }
+        case RuleAction::PULSE:
+            setTarget(slot, true);
+            pulsing[slot] = true;
+            pulseTs[slot] = millis();
+            break;
+        default:
+            break;
+    }
+}
+
+bool RuleEngine::spin() {
+    bool busy = false;
+
+    for (uint8_t i = 0; i < RULE_MAX_RULES; i++) {
+        if (rules[i].trigger == RuleTrigger::NONE) continue;
+
+        bool on = condition(i);
+        if (!primed[i]) {
+            // take the state found at start or after a change of the rule,
+            // edges before it are unknown, a followed level is not
+            primed[i] = true;
+            if (rules[i].action == RuleAction::FOLLOW) setTarget(i, on);
+        } else if (on != active[i]) {
+            run(i, on);
+            busy = true;
+        }
+        active[i] = on;
+
+        if (pulsing[i] && millis() - pulseTs[i] > rules[i].time * RULE_TIME_UNIT) {
+            pulsing[i] = false;
+            setTarget(i, false);
+            busy = true;
+        }
+    }
+    return busy;
+}
+
+void RuleEngine::writeJson(Print &out) {
+    uint8_t data[RULE_SIZE];
+
+    out.print(F("{\"rules\": ["));
+    for (uint8_t i = 0; i < RULE_MAX_RULES; i++) {
+        if (i > 0) out.print(F(", "));
+        encode(rules[i], data);
+        out.print(F("\""));
+        for (uint8_t b = 0; b < RULE_SIZE; b++) {
+            if (data[b] < 0x10) out.print(F("0"));
+            out.print(data[b], HEX);
+        }
+        out.print(F("\""));
+    }
+    out.print(F("]}"));
+}
+
+#endif // USE_RULES
@@ -0,0 +1,97 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "task.h"
+#include "device/device.h"
+
+#ifdef USE_RULES
+
+#define RULE_MAX_RULES 8
+#define RULE_SIZE 10                // bytes of an encoded rule, 20 hex digits over HTTP
+#define RULE_EXPONENT (-2)          // thresholds and hysteresis in 1/100 of the source unit
+#define RULE_TIME_UNIT 100UL        // ms per unit of the pulse time
+#define RULE_EEPROM_ADDRESS 0       // magic byte, device list fingerprint, then RULE_MAX_RULES encoded rules
+#define RULE_EEPROM_MAGIC 0x52
+#define RULE_EEPROM_RULES (RULE_EEPROM_ADDRESS + 3)
+
+// The condition of a rule, its action runs when the condition becomes true
+enum class RuleTrigger : uint8_t {
+    NONE,   // empty slot
+    RISE,   // source on
+    FALL,   // source off
+    CHANGE, // source on, the action also runs when it turns off
+    ABOVE,  // source > threshold, until below threshold - hysteresis
+    BELOW   // source < threshold, until above threshold + hysteresis
+};
+
+enum class RuleAction : uint8_t {
+    ON,
+    OFF,
+    TOGGLE,
+    FOLLOW, // target on while the condition is true, off otherwise
+    PULSE   // target on, off after time, a new trigger restarts the time
+};
+
+// Encoded big endian as
+// trigger << 4 | action, source, channel, target, threshold (int16), hysteresis, time (100 ms)
+// source and target are indexes into the device list, channel one of the source
+struct Rule {
+    RuleTrigger trigger = RuleTrigger::NONE;
+    RuleAction action = RuleAction::ON;
+    uint8_t source = 0;
+    uint8_t channel = 0;
+    uint8_t target = 0;
+    int16_t threshold = 0;
+    uint16_t hysteresis = 0;
+    uint16_t time = 0;
+};
+
+// Input to relay reactions without a round trip over the network. Every
+// rule is evaluated once per scan, so a relay follows an input within the
+// same scheduler pass when the engine is added after the devices. The
+// cost is bounded by RULE_MAX_RULES reads of device values per pass.
+class RuleEngine : public Task {
+    private:
+        Device **devices;
+        uint8_t deviceCount = 0;
+        uint16_t fingerprint = 0;   // CRC of the rule size and the device names in list order
+
+        Rule rules[RULE_MAX_RULES];
+        bool primed[RULE_MAX_RULES];    // state taken once without running the action
+        bool active[RULE_MAX_RULES];    // condition of the last scan
+        bool pulsing[RULE_MAX_RULES];
+        unsigned long pulseTs[RULE_MAX_RULES];
+
+        bool condition(uint8_t slot);
+        void run(uint8_t slot, bool on);
+        void setTarget(uint8_t slot, bool on);
+
+        static void encode(const Rule &rule, uint8_t *data);
+        static void decode(const uint8_t *data, Rule &rule);
+        bool valid(const Rule &rule);
+        void store();
+    public:
+        RuleEngine(Device **_devices);
+        // Read the rules stored in EEPROM. The table stays empty without them or
+        // when they were stored for another device list, as the indexes would
+        // then point at other devices.
+        void load();
+
+        bool spin() override;
+        unsigned long nextSpin() override { return TASK_POLL_INTERVAL; }
+        const char* getName() override { return "rules"; }
+
+        // Replace a rule from RULE_SIZE * 2 hex digits and store it in EEPROM,
+        // all zeros clears the slot. False if the rule is malformed.
+        bool set(uint8_t slot, const char *hex);
+
+        // {"rules": ["<hex>", ...]}, one entry per slot
+        void writeJson(Print &out);
+};
+
+#endif // USE_RULES
+
+#endif // RULES_H
@@ -0,0 +1,68 @@
+#include "scheduler.h"
+
+#if defined(USE_IDLE_SLEEP) && defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+bool Scheduler::add(Task *task) {
+    if (task == nullptr || count >= SCHEDULER_MAX_TASKS) return false;
+
+    tasks[count].task = task;
+    tasks[count].due = millis();
+    count++;
+
+#ifdef USE_PROFILER
+    profiler.add(task);
+#endif // USE_PROFILER
+    return true;
+}
+
+void Scheduler::wake(Task *task) {
+    for (size_t i = 0; i < count; i++) {
+        if (tasks[i].task == task) {
+            tasks[i].due = millis();
+            return;
+        }
+    }
+}
+
+bool Scheduler::spin() {
+    bool busy = false;
+
+    for (size_t i = 0; i < count; i++) {
+        Entry &entry = tasks[i];
+        unsigned long now = millis();
+
+        // signed difference keeps working when millis() wraps around
+        if (static_cast<long>(now - entry.due) < 0) continue;
+
+#ifdef USE_PROFILER
+        unsigned long start = micros();
+        bool taskBusy = entry.task->spin();
+        profiler.record(i, micros() - start);
+#else
+        bool taskBusy = entry.task->spin();
+#endif // USE_PROFILER
+
+        if (taskBusy) {
+            busy = true;
+            entry.due = now; // follow-up work, spin again on the next pass
+        } else {
+            entry.due = now + entry.task->nextSpin();
+        }
+    }
+    return busy;
+}
+
+void Scheduler::idle() {
+#if defined(USE_IDLE_SLEEP) && defined(__AVR__)
+    unsigned long now = millis();
+    for (size_t i = 0; i < count; i++) {
+        if (static_cast<long>(now - tasks[i].due) >= 0) return; // something is due
+    }
+
+    // Timer0 wakes us up on the next millis() tick at the latest
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "task.h"
+#include "profiler.h"
+
+// Cooperative scheduler, spins a task only when its deadline is due.
+// A busy task is spun again on the next pass, an idle one is asked
+// for its next deadline.
+class Scheduler {
+    private:
+        struct Entry {
+            Task *task;
+            unsigned long due; // millis() when the task is spun next
+        };
+
+        Entry tasks[SCHEDULER_MAX_TASKS];
+        size_t count = 0;
+
+#ifdef USE_PROFILER
+        Profiler profiler; // Timing of every spin(), slots follow the task order
+#endif // USE_PROFILER
+
+    public:
+        bool add(Task *task);
+        // Spin the task on the next pass, eg. after an external event
+        void wake(Task *task);
+
+        // Spin all due tasks, returns true if any of them was busy
+        bool spin();
+        // Sleep until the next interrupt if no task is due (USE_IDLE_SLEEP)
+        void idle();
+
+#ifdef USE_PROFILER
+        Profiler* getProfiler() { return &profiler; }
+#endif // USE_PROFILER
+};
+
+#endif // SCHEDULER_H
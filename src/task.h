@@ -0,0 +1,39 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#define TASK_IDLE 0x7FFFFFFFUL  // No deadline, the task waits to be woken up
+// ms between polls of idle network sockets. Polling every pass answers a
+// request within one short pass; with idle sleep the MCU may sleep a tick
+// in between, at up to 1 ms more latency.
+#ifdef USE_IDLE_SLEEP
+#define TASK_POLL_INTERVAL 1
+#else
+#define TASK_POLL_INTERVAL 0
+#endif
+#define SCHEDULER_MAX_TASKS 25  // Tasks the scheduler and the profiler have room for
+
+// Anything the scheduler can spin
+class Task {
+protected:
+    // ms left until millis() - ts > interval, as checked by the spin() methods
+    static unsigned long remaining(unsigned long ts, unsigned long interval) {
+        unsigned long elapsed = millis() - ts;
+        return elapsed > interval ? 0 : interval - elapsed + 1;
+    }
+
+public:
+    virtual bool spin() = 0;
+    virtual const char* getName() { return "task"; }
+
+    // ms until spin() has something to do, asked after a spin() which
+    // was not busy. 0 means every pass, TASK_IDLE means never on its own.
+    virtual unsigned long nextSpin() { return 0; }
+
+    virtual ~Task() {}
+};
+
+#endif // TASK_H
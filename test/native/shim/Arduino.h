@@ -0,0 +1,100 @@
+#ifndef NATIVE_ARDUINO_SHIM_H
+#define NATIVE_ARDUINO_SHIM_H
+
+// The part of the Arduino core the pure logic under test uses, for the
+// native test environment. Time and port levels are set by the tests.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+#define pgm_read_byte(p) (*reinterpret_cast<const uint8_t *>(p))
+#define pgm_read_word(p) (*reinterpret_cast<const uint16_t *>(p))
+#define pgm_read_dword(p) (*reinterpret_cast<const uint32_t *>(p))
+#define pgm_read_float(p) (*reinterpret_cast<const float *>(p))
+
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// the clock, advanced by the tests
+inline unsigned long shimMicros = 0;
+inline unsigned long micros() { return shimMicros; }
+inline unsigned long millis() { return shimMicros / 1000UL; }
+inline void delay(unsigned long ms) { shimMicros += ms * 1000UL; }
+inline void delayMicroseconds(unsigned int us) { shimMicros += us; }
+
+// PINx registers of 4 ports, 8 pins each, levels set by the tests
+inline volatile uint8_t shimPorts[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+#define digitalPinToPort(pin) ((pin) / 8)
+#define digitalPinToBitMask(pin) (1 << ((pin) % 8))
+#define portInputRegister(port) (&shimPorts[port])
+inline int digitalRead(uint8_t pin) { return (shimPorts[pin / 8] >> (pin % 8)) & 1; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline volatile uint8_t SREG = 0;
+inline void cli() {}
+inline void sei() {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class String {
+    public:
+        String(const char *s = "") : str(s) {}
+        const char* c_str() const { return str; }
+    private:
+        const char *str;
+};
+
+class Print {
+    public:
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buf, size_t len) {
+            size_t n = 0;
+            while (len--) n += write(*buf++);
+            return n;
+        }
+        size_t write(const char *s, size_t len) { return write(reinterpret_cast<const uint8_t *>(s), len); }
+
+        size_t print(const char *s) { return write(s, strlen(s)); }
+        size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+        size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+        size_t print(long v, int base = DEC) { return printf(base == HEX ? "%lX" : "%ld", v); }
+        size_t print(unsigned long v, int base = DEC) { return printf(base == HEX ? "%lX" : "%lu", v); }
+        size_t print(int v, int base = DEC) { return print(static_cast<long>(v), base); }
+        size_t print(unsigned int v, int base = DEC) { return print(static_cast<unsigned long>(v), base); }
+        size_t println() { return print("\r\n"); }
+        template <typename T> size_t println(T v) { return print(v) + println(); }
+
+        virtual void flush() {}
+        virtual ~Print() {}
+
+    private:
+        size_t printf(const char *format, unsigned long v) {
+            char buf[24];
+            snprintf(buf, sizeof(buf), format, v);
+            return print(buf);
+        }
+        size_t printf(const char *format, long v) {
+            char buf[24];
+            snprintf(buf, sizeof(buf), format, v);
+            return print(buf);
+        }
+};
+
+#endif // NATIVE_ARDUINO_SHIM_H
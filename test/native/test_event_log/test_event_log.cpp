@@ -0,0 +1,122 @@
+#include <unity.h>
+
+#define USE_EVENT_LOG
+
+#include "device/fixedPoint.cpp"
+#include "device/device.cpp"
+#include "eventLog.cpp"
+
+class FakeDevice : public Device {
+    public:
+        bool spin() override { return false; }
+        setValueType getType() override { return setValueType::BOOL; }
+        unsigned int serialize(char *s, size_t len) override { return 0; }
+};
+
+static FakeDevice input, relay;
+
+void setUp() {
+    eventLog = EventLog();
+}
+void tearDown() {}
+
+// a reader polling the log, it asks from the sequence number after the last
+// event it has seen, like a Modbus client with the FIFO pointer address
+struct Reader {
+    uint16_t next = 0;
+    unsigned int seen = 0;
+    unsigned int missed = 0;
+
+    void poll() {
+        if (eventLog.at(next) == nullptr && next != eventLog.getNext()) {
+            // overwritten while the reader was away, skip to the oldest held
+            missed += static_cast<uint16_t>(eventLog.getFirst() - next);
+            next = eventLog.getFirst();
+        }
+        while (eventLog.at(next) != nullptr) {
+            seen++;
+            next++;
+        }
+    }
+};
+
+static void test_records_in_order() {
+    eventLog.record(&input, 0, true, 100);
+    eventLog.record(&relay, 0, true, 101);
+    eventLog.record(&input, 1, false, 102);
+
+    TEST_ASSERT_EQUAL_UINT16(0, eventLog.getFirst());
+    TEST_ASSERT_EQUAL_UINT16(3, eventLog.getNext());
+
+    const DeviceEvent *e = eventLog.at(2);
+    TEST_ASSERT_NOT_NULL(e);
+    TEST_ASSERT_EQUAL_PTR(&input, e->dev);
+    TEST_ASSERT_EQUAL_UINT(1, e->channel);
+    TEST_ASSERT_FALSE(e->on);
+    TEST_ASSERT_EQUAL_UINT32(102, e->ms);
+    TEST_ASSERT_NULL(eventLog.at(3)); // not logged yet
+}
+
+static void test_oldest_is_overwritten() {
+    for (unsigned int i = 0; i < EVENT_LOG_SIZE + 5; i++) {
+        eventLog.record(&input, 0, i & 1, i);
+    }
+    TEST_ASSERT_EQUAL_UINT16(5, eventLog.getFirst());
+    TEST_ASSERT_NULL(eventLog.at(4));
+    TEST_ASSERT_EQUAL_UINT32(5, eventLog.at(5)->ms);
+    TEST_ASSERT_EQUAL_UINT32(EVENT_LOG_SIZE + 4, eventLog.at(EVENT_LOG_SIZE + 4)->ms);
+}
+
+static void test_sequence_wraps_around() {
+    // 65536 + 10 events, the 16 bit sequence numbers wrap
+    for (unsigned long i = 0; i < 65546UL; i++) {
+        eventLog.record(&input, 0, i & 1, i);
+    }
+    TEST_ASSERT_EQUAL_UINT16(10, eventLog.getNext());
+    TEST_ASSERT_EQUAL_UINT16(static_cast<uint16_t>(10 - EVENT_LOG_SIZE), eventLog.getFirst());
+
+    // events on both sides of the wrap are found by their sequence number
+    TEST_ASSERT_EQUAL_UINT32(65535UL, eventLog.at(65535)->ms);
+    TEST_ASSERT_EQUAL_UINT32(65536UL, eventLog.at(0)->ms);
+    TEST_ASSERT_EQUAL_UINT32(65545UL, eventLog.at(9)->ms);
+    TEST_ASSERT_NULL(eventLog.at(10));
+}
+
+static void test_readers_catch_up_independently() {
+    Reader fast, slow;
+
+    for (int i = 0; i < 10; i++) {
+        eventLog.record(&input, 0, i & 1, i);
+        fast.poll(); // after every event
+    }
+    slow.poll(); // once, all 10 are still held
+    TEST_ASSERT_EQUAL_UINT(10, fast.seen);
+    TEST_ASSERT_EQUAL_UINT(10, slow.seen);
+
+    // the slow reader is away for more than the log holds
+    for (int i = 0; i < EVENT_LOG_SIZE + 4; i++) {
+        eventLog.record(&relay, 0, i & 1, i);
+        fast.poll();
+    }
+    slow.poll();
+    TEST_ASSERT_EQUAL_UINT(10 + EVENT_LOG_SIZE + 4, fast.seen);
+    TEST_ASSERT_EQUAL_UINT(0, fast.missed);
+    TEST_ASSERT_EQUAL_UINT(4, slow.missed);
+    TEST_ASSERT_EQUAL_UINT(10 + EVENT_LOG_SIZE, slow.seen);
+    TEST_ASSERT_EQUAL_UINT16(eventLog.getNext(), slow.next);
+
+    // reading removes nothing, a reader starting over still sees all held
+    Reader late;
+    late.next = eventLog.getFirst();
+    late.poll();
+    TEST_ASSERT_EQUAL_UINT(EVENT_LOG_SIZE, late.seen);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_in_order);
+    RUN_TEST(test_oldest_is_overwritten);
+    RUN_TEST(test_sequence_wraps_around);
+    RUN_TEST(test_readers_catch_up_independently);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+#include <unity.h>
+#include <chrono>
+
+#include "device/fixedPoint.cpp"
+#include "device/device.cpp"
+#include "net/modbusNode.cpp"
+
+#define BENCH_ROUNDS 200000
+
+void setUp() {}
+void tearDown() {}
+
+static void test_rescale_more_decimals() {
+    TEST_ASSERT_EQUAL_INT32(2150, fixedRescale(215, -1, -2));
+    TEST_ASSERT_EQUAL_INT32(-1000, fixedRescale(-1, 0, -3));
+    TEST_ASSERT_EQUAL_INT32(2147483647L, fixedRescale(300000000L, 0, -1));
+    TEST_ASSERT_EQUAL_INT32(-2147483647L - 1, fixedRescale(-300000000L, 0, -1));
+}
+
+static void test_rescale_rounds_half_away_from_zero() {
+    TEST_ASSERT_EQUAL_INT32(22, fixedRescale(2150, -3, -1));
+    TEST_ASSERT_EQUAL_INT32(21, fixedRescale(2149, -3, -1));
+    TEST_ASSERT_EQUAL_INT32(-22, fixedRescale(-2150, -3, -1));
+    TEST_ASSERT_EQUAL_INT32(-21, fixedRescale(-2149, -3, -1));
+    TEST_ASSERT_EQUAL_INT32(0, fixedRescale(4, -1, 0));
+    TEST_ASSERT_EQUAL_INT32(1, fixedRescale(5, -1, 0));
+}
+
+static void test_format() {
+    char s[16];
+    FixedValue t = {2150, -2};
+    TEST_ASSERT_EQUAL_UINT(5, fixedFormat(s, sizeof(s), t, 2));
+    TEST_ASSERT_EQUAL_STRING("21.50", s);
+
+    FixedValue small = {-5, -3};
+    fixedFormat(s, sizeof(s), small, 3);
+    TEST_ASSERT_EQUAL_STRING("-0.005", s);
+
+    FixedValue whole = {7, 1};
+    fixedFormat(s, sizeof(s), whole, 0);
+    TEST_ASSERT_EQUAL_STRING("70", s);
+
+    // too long for the buffer, cut and terminated like snprintf
+    FixedValue big = {-2147483647L, -4};
+    fixedFormat(s, 6, big, 4);
+    TEST_ASSERT_EQUAL_STRING("-2147", s);
+}
+
+static void test_to_float() {
+    FixedValue t = {2150, -2};
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 21.5f, fixedToFloat(t));
+    FixedValue f = {-12345, -3};
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, -12.345f, fixedToFloat(f));
+    FixedValue e = {3, 11};
+    TEST_ASSERT_FLOAT_WITHIN(1e5f, 3e11f, fixedToFloat(e));
+}
+
+// the default register nodes take the integer path, no float on the way
+static void test_scaled_register_is_exact() {
+    ModbusNode node(nullptr, setValueType::FIXED, 0, ModbusEncoding::INT32, 100.0);
+    setValue v;
+    v.x = {-2156, -3}; // -2.156 C
+    unsigned char regs[4];
+    node.encode(v, regs);
+    uint32_t raw = (static_cast<uint32_t>(regs[0]) << 24) | (regs[1] << 16) | (regs[2] << 8) | regs[3];
+    TEST_ASSERT_EQUAL_INT32(-216, static_cast<int32_t>(raw));
+
+    uint32_t exact;
+    TEST_ASSERT_TRUE(node.encodeExact(v, exact));
+}
+
+// Host cost per call. The host has an FPU, so the float rows are far
+// cheaper than on the AVR, where each float op is a soft-float call of
+// hundreds of cycles; read them for regressions, not for the AVR budget.
+static float oldFixedToFloat(const FixedValue &value) {
+    float f = value.mantissa;
+    for (int8_t e = value.exponent; e < 0; e++) f /= 10;
+    for (int8_t e = value.exponent; e > 0; e--) f *= 10;
+    return f;
+}
+
+template <typename F>
+static double nsPerCall(F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < BENCH_ROUNDS; i++) f(i);
+    std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+    return took.count() / BENCH_ROUNDS;
+}
+
+static void report(const char *what, double ns) {
+    char line[80];
+    snprintf(line, sizeof(line), "%-32s %7.1f ns/call", what, ns);
+    TEST_MESSAGE(line);
+}
+
+static void bench_conversions() {
+    volatile float fsink = 0;
+    volatile int32_t isink = 0;
+    char s[16];
+
+    report("fixedToFloat, divide per decimal", nsPerCall([&](long i) {
+        FixedValue v = {static_cast<int32_t>(i), -4};
+        fsink = oldFixedToFloat(v);
+    }));
+    report("fixedToFloat, table multiply", nsPerCall([&](long i) {
+        FixedValue v = {static_cast<int32_t>(i), -4};
+        fsink = fixedToFloat(v);
+    }));
+    report("fixedRescale -4 to -2", nsPerCall([&](long i) {
+        isink = fixedRescale(static_cast<int32_t>(i), -4, -2);
+    }));
+    report("fixedFormat, 2 decimals", nsPerCall([&](long i) {
+        FixedValue v = {static_cast<int32_t>(i), -4};
+        fixedFormat(s, sizeof(s), v, 2);
+    }));
+
+    ModbusNode asFloat(nullptr, setValueType::FIXED, 0, ModbusEncoding::FLOAT32);
+    ModbusNode asInt(nullptr, setValueType::FIXED, 0, ModbusEncoding::INT32, 100.0);
+    unsigned char regs[4];
+    report("register encode, FLOAT32", nsPerCall([&](long i) {
+        setValue v;
+        v.x = {static_cast<int32_t>(i), -4};
+        asFloat.encode(v, regs);
+    }));
+    report("register encode, INT32 x100", nsPerCall([&](long i) {
+        setValue v;
+        v.x = {static_cast<int32_t>(i), -4};
+        asInt.encode(v, regs);
+    }));
+    (void)fsink;
+    (void)isink;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rescale_more_decimals);
+    RUN_TEST(test_rescale_rounds_half_away_from_zero);
+    RUN_TEST(test_format);
+    RUN_TEST(test_to_float);
+    RUN_TEST(test_scaled_register_is_exact);
+    RUN_TEST(bench_conversions);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+#include <unity.h>
+
+#include "device/fixedPoint.cpp"
+#include "device/device.cpp"
+#include "device/binaryInput.cpp"
+#include "device/inputBank.cpp"
+
+// no pin change interrupts on the host, banked inputs never ask for one
+bool PinChange::attach(int, EdgeBuffer*) { return false; }
+
+#define IN3_PIN 18  // port 2, bit 2
+#define IN4_PIN 19  // port 2, bit 3
+
+void setUp() {
+    shimMicros = 0;
+    shimPorts[2] = 0xFF; // pulled up, nothing pressed
+}
+void tearDown() {}
+
+static void press(uint8_t pin, bool on) {
+    // inputs are pulled up, pressed is low
+    volatile uint8_t &port = shimPorts[digitalPinToPort(pin)];
+    uint8_t mask = digitalPinToBitMask(pin);
+    port = on ? port & ~mask : port | mask;
+}
+
+// one sample of the bank, the tick is over every call
+static bool tick(InputBank &bank) {
+    shimMicros += (INPUT_BANK_TICK + 1) * 1000UL;
+    return bank.spin();
+}
+
+static bool level(Device &dev) {
+    setValue v;
+    dev.get(v);
+    return v.b;
+}
+
+static void test_level_must_hold_four_samples() {
+    BinaryInput in3("input_3", IN3_PIN, InputMode::BANKED);
+    InputBank bank("inputs");
+    TEST_ASSERT_TRUE(bank.attach(&in3));
+
+    press(IN3_PIN, true);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FALSE(tick(bank));
+        TEST_ASSERT_FALSE(level(in3));
+    }
+    TEST_ASSERT_TRUE(tick(bank));
+    TEST_ASSERT_TRUE(level(in3));
+    TEST_ASSERT_EQUAL_UINT32(1, in3.getPulses());
+
+    // the release is debounced the same way
+    press(IN3_PIN, false);
+    for (int i = 0; i < 3; i++) tick(bank);
+    TEST_ASSERT_TRUE(level(in3));
+    tick(bank);
+    TEST_ASSERT_FALSE(level(in3));
+    TEST_ASSERT_EQUAL_UINT32(1, in3.getPulses());
+}
+
+static void test_bounce_restarts_the_count() {
+    BinaryInput in3("input_3", IN3_PIN, InputMode::BANKED);
+    InputBank bank("inputs");
+    bank.attach(&in3);
+
+    // 3 samples low, one high, a glitch is never accepted
+    for (int round = 0; round < 5; round++) {
+        press(IN3_PIN, true);
+        for (int i = 0; i < 3; i++) tick(bank);
+        press(IN3_PIN, false);
+        tick(bank);
+    }
+    TEST_ASSERT_FALSE(level(in3));
+    TEST_ASSERT_EQUAL_UINT32(0, in3.getPulses());
+}
+
+static void test_inputs_are_counted_independently() {
+    BinaryInput in3("input_3", IN3_PIN, InputMode::BANKED);
+    BinaryInput in4("input_4", IN4_PIN, InputMode::BANKED);
+    InputBank bank("inputs");
+    bank.attach(&in3);
+    bank.attach(&in4);
+
+    press(IN3_PIN, true);
+    tick(bank);
+    tick(bank);
+    press(IN4_PIN, true); // two samples behind
+    tick(bank);
+    tick(bank);
+    TEST_ASSERT_TRUE(level(in3));
+    TEST_ASSERT_FALSE(level(in4));
+    tick(bank);
+    tick(bank);
+    TEST_ASSERT_TRUE(level(in4));
+
+    // the bank serves the levels as channels in attach() order
+    press(IN3_PIN, false);
+    for (int i = 0; i < 4; i++) tick(bank);
+    setValue values[2];
+    TEST_ASSERT_EQUAL_UINT(2, bank.getMany(0, 2, values));
+    TEST_ASSERT_FALSE(values[0].b);
+    TEST_ASSERT_TRUE(values[1].b);
+    TEST_ASSERT_EQUAL_UINT(1, bank.getMany(1, 4, values));
+    TEST_ASSERT_TRUE(values[0].b);
+    TEST_ASSERT_EQUAL_UINT(0, bank.getMany(2, 1, values));
+}
+
+static void test_samples_once_per_tick() {
+    BinaryInput in3("input_3", IN3_PIN, InputMode::BANKED);
+    InputBank bank("inputs");
+    bank.attach(&in3);
+
+    press(IN3_PIN, true);
+    tick(bank);
+    // spins within the tick do not count as samples
+    for (int i = 0; i < 10; i++) bank.spin();
+    tick(bank);
+    tick(bank);
+    TEST_ASSERT_FALSE(level(in3));
+    tick(bank);
+    TEST_ASSERT_TRUE(level(in3));
+}
+
+static void test_attach_rejects_other_port() {
+    BinaryInput in3("input_3", IN3_PIN, InputMode::BANKED);
+    BinaryInput other("other", 8, InputMode::BANKED); // port 1
+    InputBank bank("inputs");
+    TEST_ASSERT_TRUE(bank.attach(&in3));
+    TEST_ASSERT_FALSE(bank.attach(&other));
+    TEST_ASSERT_EQUAL_UINT(1, bank.getChannelCount());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_level_must_hold_four_samples);
+    RUN_TEST(test_bounce_restarts_the_count);
+    RUN_TEST(test_inputs_are_counted_independently);
+    RUN_TEST(test_samples_once_per_tick);
+    RUN_TEST(test_attach_rejects_other_port);
+    return UNITY_END();
+}
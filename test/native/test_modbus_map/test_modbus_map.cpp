@@ -0,0 +1,133 @@
+#include <unity.h>
+
+#include "device/fixedPoint.cpp"
+#include "device/device.cpp"
+#include "net/modbusNode.cpp"
+#include "net/modbusMap.cpp"
+
+void setUp() {}
+void tearDown() {}
+
+// a device with a number of channels, no behaviour needed for the map
+class FakeDevice : public Device {
+    private:
+        uint8_t channels;
+    public:
+        FakeDevice(uint8_t _channels = 1) : channels(_channels) {}
+        bool spin() override { return false; }
+        setValueType getType() override { return setValueType::BOOL; }
+        unsigned int serialize(char *s, size_t len) override { return 0; }
+        uint8_t getChannelCount() override { return channels; }
+};
+
+static FakeDevice a, b, c;
+static FakeDevice bank(2);
+
+static void test_sorts_by_space_then_address() {
+    ModbusNode table[] = {
+        ModbusNode{&a, setValueType::FIXED, 10, ModbusEncoding::INT32},
+        ModbusNode{&b, setValueType::BOOL, 7},
+        ModbusNode{&c, setValueType::INT, 2},
+        ModbusNode{&a, setValueType::BOOL, 3},
+        {}
+    };
+    ModbusMap map;
+    TEST_ASSERT_TRUE(map.build(table));
+
+    TEST_ASSERT_EQUAL_UINT(2, map.getBitCount());
+    TEST_ASSERT_EQUAL_UINT(3, map.getBits()[0].startAddress);
+    TEST_ASSERT_EQUAL_UINT(7, map.getBits()[1].startAddress);
+
+    TEST_ASSERT_EQUAL_UINT(2, map.getRegisterCount());
+    TEST_ASSERT_EQUAL_UINT(2, map.getRegisters()[0].startAddress);
+    TEST_ASSERT_EQUAL_UINT(10, map.getRegisters()[1].startAddress);
+
+    // image slots follow the sorted order, a 32 bit node takes two
+    TEST_ASSERT_EQUAL_UINT(0, map.getRegisters()[0].slot);
+    TEST_ASSERT_EQUAL_UINT(1, map.getRegisters()[1].slot);
+    TEST_ASSERT_EQUAL_UINT(3, map.getRegisterSlots());
+}
+
+static void test_rejects_overlap_and_duplicates() {
+    ModbusNode overlap[] = {
+        ModbusNode{&a, setValueType::FIXED, 0, ModbusEncoding::FLOAT32},
+        ModbusNode{&b, setValueType::INT, 1}, // inside registers 0-1
+        {}
+    };
+    ModbusMap map;
+    TEST_ASSERT_FALSE(map.build(overlap));
+
+    ModbusNode duplicate[] = {
+        ModbusNode{&a, setValueType::BOOL, 4},
+        ModbusNode{&b, setValueType::BOOL, 4},
+        {}
+    };
+    TEST_ASSERT_FALSE(map.build(duplicate));
+
+    // the same address in both spaces is fine
+    ModbusNode spaces[] = {
+        ModbusNode{&a, setValueType::BOOL, 4},
+        ModbusNode{&b, setValueType::INT, 4},
+        {}
+    };
+    TEST_ASSERT_TRUE(map.build(spaces));
+}
+
+static void test_rejects_nodes_it_can_not_serve() {
+    ModbusNode wrongQuantity[] = {
+        ModbusNode{&a, setValueType::INT, 0, 2}, // INT16 is one register
+        {}
+    };
+    ModbusMap map;
+    TEST_ASSERT_FALSE(map.build(wrongQuantity));
+
+    ModbusNode noChannel[] = {
+        ModbusNode{&bank, setValueType::BOOL, 0, 1, 1.0, 2}, // channels 0 and 1 only
+        {}
+    };
+    TEST_ASSERT_FALSE(map.build(noChannel));
+}
+
+static void test_lookup() {
+    ModbusNode table[] = {
+        ModbusNode{&a, setValueType::FIXED, 100, ModbusEncoding::INT32},
+        ModbusNode{&b, setValueType::INT, 0},
+        ModbusNode{&c, setValueType::FIXED, 4, ModbusEncoding::UINT32},
+        ModbusNode{&bank, setValueType::BOOL, 5, 1, 1.0, 0},
+        ModbusNode{&bank, setValueType::BOOL, 6, 1, 1.0, 1},
+        {}
+    };
+    ModbusMap map;
+    TEST_ASSERT_TRUE(map.build(table));
+
+    TEST_ASSERT_EQUAL_PTR(&b, map.findRegister(0)->dev);
+    TEST_ASSERT_NULL(map.findRegister(1));  // gap
+    TEST_ASSERT_EQUAL_PTR(&c, map.findRegister(4)->dev);
+    TEST_ASSERT_EQUAL_PTR(&c, map.findRegister(5)->dev); // second word
+    TEST_ASSERT_NULL(map.findRegister(6));
+    TEST_ASSERT_EQUAL_PTR(&a, map.findRegister(101)->dev);
+    TEST_ASSERT_NULL(map.findRegister(102)); // past the last node
+
+    TEST_ASSERT_NULL(map.findBit(4));
+    TEST_ASSERT_EQUAL_UINT(1, map.findBit(6)->channel);
+    TEST_ASSERT_EQUAL_UINT(6, map.findBitOf(&bank, 1)->startAddress);
+    TEST_ASSERT_NULL(map.findBitOf(&a, 0));
+}
+
+static void test_empty_table() {
+    ModbusNode table[] = { {} };
+    ModbusMap map;
+    TEST_ASSERT_TRUE(map.build(table));
+    TEST_ASSERT_NULL(map.findBit(0));
+    TEST_ASSERT_NULL(map.findRegister(0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sorts_by_space_then_address);
+    RUN_TEST(test_rejects_overlap_and_duplicates);
+    RUN_TEST(test_rejects_nodes_it_can_not_serve);
+    RUN_TEST(test_lookup);
+    RUN_TEST(test_empty_table);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+#include <unity.h>
+
+#include "device/fixedPoint.cpp"
+#include "device/device.cpp"
+#include "net/modbusNode.cpp"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_widths() {
+    TEST_ASSERT_EQUAL_UINT(1, ModbusNode::width(ModbusEncoding::INT16));
+    TEST_ASSERT_EQUAL_UINT(1, ModbusNode::width(ModbusEncoding::UINT16));
+    TEST_ASSERT_EQUAL_UINT(2, ModbusNode::width(ModbusEncoding::INT32));
+    TEST_ASSERT_EQUAL_UINT(2, ModbusNode::width(ModbusEncoding::UINT32));
+    TEST_ASSERT_EQUAL_UINT(2, ModbusNode::width(ModbusEncoding::FLOAT32));
+
+    ModbusNode node(nullptr, setValueType::UINT32, 0, ModbusEncoding::UINT32);
+    TEST_ASSERT_EQUAL_UINT(2, node.quantity);
+}
+
+static void test_uint32_word_order() {
+    setValue v;
+    v.u = 0x12345678UL;
+    unsigned char regs[4];
+
+    ModbusNode high(nullptr, setValueType::UINT32, 0, ModbusEncoding::UINT32);
+    high.encode(v, regs);
+    const unsigned char big[] = {0x12, 0x34, 0x56, 0x78};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(big, regs, 4);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678UL, high.decode(regs).u);
+
+    ModbusNode low(nullptr, setValueType::UINT32, 0, ModbusEncoding::UINT32, 1.0,
+                   ModbusWordOrder::LOW_WORD_FIRST);
+    low.encode(v, regs);
+    const unsigned char swapped[] = {0x56, 0x78, 0x12, 0x34};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(swapped, regs, 4);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678UL, low.decode(regs).u);
+}
+
+static void test_float32_word_order() {
+    setValue v;
+    v.x = {2150, -2}; // 21.5 = 0x41AC0000
+    unsigned char regs[4];
+
+    ModbusNode high(nullptr, setValueType::FIXED, 0, ModbusEncoding::FLOAT32);
+    high.encode(v, regs);
+    const unsigned char big[] = {0x41, 0xAC, 0x00, 0x00};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(big, regs, 4);
+
+    ModbusNode low(nullptr, setValueType::FIXED, 0, ModbusEncoding::FLOAT32, 1.0,
+                   ModbusWordOrder::LOW_WORD_FIRST);
+    low.encode(v, regs);
+    const unsigned char swapped[] = {0x00, 0x00, 0x41, 0xAC};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(swapped, regs, 4);
+
+    setValue back = low.decode(regs);
+    TEST_ASSERT_EQUAL_INT32(21500, back.x.mantissa);
+    TEST_ASSERT_EQUAL_INT(-3, back.x.exponent);
+}
+
+static void test_signed_values_saturate() {
+    unsigned char regs[4];
+    setValue v;
+
+    ModbusNode int16(nullptr, setValueType::FIXED, 0, ModbusEncoding::INT16, 100.0);
+    v.x = {-2156, -3};
+    int16.encode(v, regs);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, regs[0]); // -216
+    TEST_ASSERT_EQUAL_HEX8(0x28, regs[1]);
+
+    v.x = {400, 0}; // 40000 at x100, past INT16
+    int16.encode(v, regs);
+    TEST_ASSERT_EQUAL_HEX8(0x7F, regs[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, regs[1]);
+
+    ModbusNode uint16(nullptr, setValueType::FIXED, 0, ModbusEncoding::UINT16);
+    v.x = {-5, 0};
+    uint16.encode(v, regs);
+    TEST_ASSERT_EQUAL_HEX8(0x00, regs[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, regs[1]);
+}
+
+static void test_scaled_decode() {
+    // a write of 1950 to a x100 node is 19.50
+    ModbusNode node(nullptr, setValueType::FIXED, 0, ModbusEncoding::INT32, 100.0,
+                    ModbusWordOrder::LOW_WORD_FIRST);
+    const unsigned char regs[] = {0x07, 0x9E, 0x00, 0x00};
+    setValue v = node.decode(regs);
+    TEST_ASSERT_EQUAL_INT32(1950, v.x.mantissa);
+    TEST_ASSERT_EQUAL_INT(-2, v.x.exponent);
+
+    const unsigned char negative[] = {0xFF, 0x38, 0xFF, 0xFF}; // -200, low word first
+    v = node.decode(negative);
+    TEST_ASSERT_EQUAL_INT32(-200, v.x.mantissa);
+}
+
+static void test_decimal_scale() {
+    TEST_ASSERT_EQUAL_INT(0, ModbusNode::decimalScale(1.0f));
+    TEST_ASSERT_EQUAL_INT(2, ModbusNode::decimalScale(100.0f));
+    TEST_ASSERT_EQUAL_INT(-1, ModbusNode::decimalScale(0.1f));
+    TEST_ASSERT_EQUAL_INT(MODBUS_NO_SCALE, ModbusNode::decimalScale(2.5f));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_widths);
+    RUN_TEST(test_uint32_word_order);
+    RUN_TEST(test_float32_word_order);
+    RUN_TEST(test_signed_values_saturate);
+    RUN_TEST(test_scaled_decode);
+    RUN_TEST(test_decimal_scale);
+    return UNITY_END();
+}
@@ -0,0 +1,213 @@
+#include <unity.h>
+
+#include "scheduler.cpp"
+
+#define SIM_SECONDS 60
+#define SIM_PASS_US 4           // loop() overhead of one pass
+#define LATENCY_BUCKETS 100     // 20 us each, the last one collects the rest
+#define LATENCY_BUCKET_US 20
+
+void setUp() {
+    shimMicros = 0;
+}
+void tearDown() {}
+
+// A component on the simulated clock: every spin() costs checkUs, one
+// which finds its period over costs workUs on top. Costs are modelled on
+// the firmware: SPI socket polls, 1-Wire slots, port reads.
+class SimTask : public Task {
+    private:
+        unsigned long period;   // ms
+        unsigned long checkUs;
+        unsigned long workUs;
+        unsigned long ts = 0;
+
+    public:
+        SimTask(unsigned long _period, unsigned long _checkUs, unsigned long _workUs) :
+            period(_period), checkUs(_checkUs), workUs(_workUs) {}
+
+        bool spin() override {
+            unsigned long now = millis();
+            shimMicros += checkUs;
+            if (now - ts <= period) return false;
+            ts = now;
+            shimMicros += workUs;
+            return false;
+        }
+        unsigned long nextSpin() override { return remaining(ts, period); }
+};
+
+// A 1-Wire bus reading its sensors every 750 ms, one 70 us slot per spin
+class SimBus : public Task {
+    private:
+        unsigned long ts = 0;
+        unsigned int slots = 0; // left in the running transaction
+
+    public:
+        bool spin() override {
+            unsigned long now = millis();
+            shimMicros += 5;
+            if (slots > 0) {
+                shimMicros += 70;
+                return --slots > 0;
+            }
+            if (now - ts <= 750) return false;
+            ts = now;
+            slots = 2 * 8 * 19; // match ROM and scratchpad of 2 sensors
+            return true;
+        }
+        unsigned long nextSpin() override { return remaining(ts, 750); }
+};
+
+// A server socket. Requests arrive at pseudo random times, the latency
+// is how long one waits until a spin() finds it.
+class SimServer : public Task {
+    private:
+        unsigned long arrival;
+        uint32_t seed;
+
+        void nextArrival(unsigned long now) {
+            seed = seed * 1103515245UL + 12345UL;
+            arrival = now + 2000 + (seed >> 8) % 18000; // 2..20 ms apart
+        }
+
+    public:
+        unsigned long requests = 0;
+        unsigned long long totalUs = 0;
+        unsigned long maxUs = 0;
+        unsigned long hist[LATENCY_BUCKETS] = {};
+
+        SimServer(uint32_t _seed) : seed(_seed) { nextArrival(0); }
+
+        bool spin() override {
+            unsigned long now = micros();
+            shimMicros += 40; // socket status over SPI
+            if (now < arrival) return false;
+
+            unsigned long late = now - arrival;
+            requests++;
+            totalUs += late;
+            if (late > maxUs) maxUs = late;
+            unsigned long b = late / LATENCY_BUCKET_US;
+            hist[b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1]++;
+
+            shimMicros += 300; // read the request, write the answer
+            nextArrival(micros());
+            return true;
+        }
+        unsigned long nextSpin() override { return TASK_POLL_INTERVAL; }
+
+        unsigned long percentile(unsigned int pct) {
+            unsigned long wanted = requests * pct / 100, seen = 0;
+            for (unsigned int b = 0; b < LATENCY_BUCKETS; b++) {
+                seen += hist[b];
+                if (seen >= wanted) return (b + 1) * LATENCY_BUCKET_US;
+            }
+            return LATENCY_BUCKETS * LATENCY_BUCKET_US;
+        }
+};
+
+// the default build in the order of setup(): servers, 1-Wire buses,
+// 2 sensors, 3 relays, 4 inputs, 4 pulse meters and the LED
+struct Firmware {
+    SimServer http {1};
+    SimServer modbus {2};
+    SimBus bus1;
+    SimBus bus2;
+    SimTask sensor1 {TASK_IDLE, 2, 0};
+    SimTask sensor2 {TASK_IDLE, 2, 0};
+    SimTask relay1 {TASK_IDLE, 2, 0};
+    SimTask relay2 {TASK_IDLE, 2, 0};
+    SimTask relay3 {TASK_IDLE, 2, 0};
+    SimTask in1 {1, 4, 2};          // edge queue and debounce
+    SimTask in2 {1, 4, 2};
+    SimTask in3 {60000, 2, 0};      // pulse period timeout, the bank samples
+    SimTask in4 {60000, 2, 0};
+    SimTask bank {12, 3, 4};        // port read and vertical counter
+    SimTask in1Count {1000, 2, 4};
+    SimTask in2Count {1000, 2, 4};
+    SimTask in1Freq {1000, 2, 4};
+    SimTask in2Freq {1000, 2, 4};
+    SimTask led {TASK_IDLE, 2, 0};
+
+    Task* all[19] = {&http, &modbus, &bus1, &bus2, &sensor1, &sensor2,
+                     &relay1, &relay2, &relay3, &in1, &in2, &in3, &in4, &bank,
+                     &in1Count, &in2Count, &in1Freq, &in2Freq, &led};
+};
+
+static unsigned long simulate(Firmware &fw, bool scheduled) {
+    Scheduler scheduler;
+    for (Task *task : fw.all) scheduler.add(task);
+
+    unsigned long passes = 0;
+    while (shimMicros < SIM_SECONDS * 1000000UL) {
+        if (scheduled) {
+            scheduler.spin();
+        } else {
+            // the superloop before the scheduler: every component every pass
+            for (Task *task : fw.all) task->spin();
+        }
+        shimMicros += SIM_PASS_US;
+        passes++;
+    }
+    return passes;
+}
+
+static void report(const char *what, SimServer &s, unsigned long passes) {
+    char line[120];
+    snprintf(line, sizeof(line), "%-9s latency mean %4llu us, p99 <%5lu us, max %5lu us, %lu requests, %lu passes",
+             what, s.totalUs / s.requests, s.percentile(99), s.maxUs, s.requests, passes);
+    TEST_MESSAGE(line);
+}
+
+static void test_busy_task_spins_again_next_pass() {
+    struct Busy : Task {
+        int spins = 0;
+        bool spin() override { return ++spins < 3; }
+        unsigned long nextSpin() override { return TASK_IDLE; }
+    } busy;
+
+    Scheduler scheduler;
+    scheduler.add(&busy);
+    for (int i = 0; i < 5; i++) scheduler.spin();
+    TEST_ASSERT_EQUAL_INT(3, busy.spins);
+
+    scheduler.wake(&busy);
+    scheduler.spin();
+    TEST_ASSERT_EQUAL_INT(4, busy.spins);
+}
+
+static void test_idle_task_waits_for_its_deadline() {
+    SimTask task(100, 0, 0);
+    Scheduler scheduler;
+    scheduler.add(&task);
+
+    shimMicros = 101000;
+    scheduler.spin();       // runs, next due 101 ms later
+    shimMicros = 150000;
+    TEST_ASSERT_FALSE(scheduler.spin());
+}
+
+// how long a Modbus request waits for its spin(), superloop against scheduler
+static void bench_request_latency() {
+    Firmware before;
+    unsigned long loopPasses = simulate(before, false);
+    report("superloop", before.modbus, loopPasses);
+
+    shimMicros = 0;
+    Firmware after;
+    unsigned long schedPasses = simulate(after, true);
+    report("scheduler", after.modbus, schedPasses);
+
+    TEST_ASSERT_LESS_THAN(before.modbus.totalUs / before.modbus.requests,
+                          after.modbus.totalUs / after.modbus.requests);
+    TEST_ASSERT_LESS_OR_EQUAL(before.modbus.percentile(99), after.modbus.percentile(99));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_busy_task_spins_again_next_pass);
+    RUN_TEST(test_idle_task_waits_for_its_deadline);
+    RUN_TEST(bench_request_latency);
+    return UNITY_END();
+}